@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../LR35902/Registers.h"
+
+// hardware revision, selects the state the boot ROM leaves behind
+enum Model {
+    MODEL_DMG,
+    MODEL_MGB,
+    MODEL_SGB,
+    MODEL_CGB,
+    MODEL_COUNT,
+};
+
+// State each model's boot ROM hands over to the cartridge at 0x0100, so a machine can start
+// there directly instead of spending ~2.5M cycles running dmg_boot.bin.
+// Values are from Pan Docs ("Power Up Sequence"); registers it lists as unknown or random are
+// left at zero, and CGB-only registers are not covered since those devices do not exist here.
+namespace BootState {
+
+inline constexpr CPU::Registers cpu[MODEL_COUNT] = {
+    /* DMG */ {0x01, 0xb0, 0x00, 0x13, 0x00, 0xd8, 0x01, 0x4d, 0xfffe, 0x0100},
+    /* MGB */ {0xff, 0xb0, 0x00, 0x13, 0x00, 0xd8, 0x01, 0x4d, 0xfffe, 0x0100},
+    /* SGB */ {0x01, 0x00, 0x00, 0x14, 0x00, 0x00, 0xc0, 0x60, 0xfffe, 0x0100},
+    /* CGB */ {0x11, 0x80, 0x00, 0x00, 0xff, 0x56, 0x00, 0x0d, 0xfffe, 0x0100},
+};
+
+// DMG/MGB only: H and C are set unless the header checksum byte (0x014d) is zero
+inline constexpr uint8_t checksumFlags = 0x30;
+
+// Internal 16-bit divider at 0x0100. Only the DMG/MGB value is pinned down (DIV reads 0xab).
+inline constexpr uint16_t divider[MODEL_COUNT] = {
+    /* DMG */ 0xabcc,
+    /* MGB */ 0xabcc,
+    /* SGB */ 0x0000,
+    /* CGB */ 0x0000,
+};
+
+struct IORegister {
+    uint16_t addr;
+    uint8_t  value[MODEL_COUNT]; // DMG, MGB, SGB, CGB
+};
+
+// DIV is missing on purpose, it is set through the divider above
+inline constexpr IORegister io[] = {
+    {0xff00, {0xcf, 0xcf, 0xcf, 0xcf}}, // P1
+    {0xff01, {0x00, 0x00, 0x00, 0x00}}, // SB
+    {0xff02, {0x7e, 0x7e, 0x7e, 0x7f}}, // SC
+    {0xff05, {0x00, 0x00, 0x00, 0x00}}, // TIMA
+    {0xff06, {0x00, 0x00, 0x00, 0x00}}, // TMA
+    {0xff07, {0xf8, 0xf8, 0xf8, 0xf8}}, // TAC
+    {0xff0f, {0xe1, 0xe1, 0xe1, 0xe1}}, // IF
+    {0xff10, {0x80, 0x80, 0x80, 0x80}}, // NR10
+    {0xff11, {0xbf, 0xbf, 0xbf, 0xbf}}, // NR11
+    {0xff12, {0xf3, 0xf3, 0xf3, 0xf3}}, // NR12
+    {0xff13, {0xff, 0xff, 0xff, 0xff}}, // NR13
+    {0xff14, {0xbf, 0xbf, 0xbf, 0xbf}}, // NR14
+    {0xff16, {0x3f, 0x3f, 0x3f, 0x3f}}, // NR21
+    {0xff17, {0x00, 0x00, 0x00, 0x00}}, // NR22
+    {0xff18, {0xff, 0xff, 0xff, 0xff}}, // NR23
+    {0xff19, {0xbf, 0xbf, 0xbf, 0xbf}}, // NR24
+    {0xff1a, {0x7f, 0x7f, 0x7f, 0x7f}}, // NR30
+    {0xff1b, {0xff, 0xff, 0xff, 0xff}}, // NR31
+    {0xff1c, {0x9f, 0x9f, 0x9f, 0x9f}}, // NR32
+    {0xff1d, {0xff, 0xff, 0xff, 0xff}}, // NR33
+    {0xff1e, {0xbf, 0xbf, 0xbf, 0xbf}}, // NR34
+    {0xff20, {0xff, 0xff, 0xff, 0xff}}, // NR41
+    {0xff21, {0x00, 0x00, 0x00, 0x00}}, // NR42
+    {0xff22, {0x00, 0x00, 0x00, 0x00}}, // NR43
+    {0xff23, {0xbf, 0xbf, 0xbf, 0xbf}}, // NR44
+    {0xff24, {0x77, 0x77, 0x77, 0x77}}, // NR50
+    {0xff25, {0xf3, 0xf3, 0xf3, 0xf3}}, // NR51
+    {0xff26, {0xf1, 0xf1, 0xf0, 0xf1}}, // NR52
+    {0xff40, {0x91, 0x91, 0x91, 0x91}}, // LCDC
+    {0xff41, {0x85, 0x85, 0x85, 0x85}}, // STAT
+    {0xff42, {0x00, 0x00, 0x00, 0x00}}, // SCY
+    {0xff43, {0x00, 0x00, 0x00, 0x00}}, // SCX
+    {0xff45, {0x00, 0x00, 0x00, 0x00}}, // LYC
+    {0xff46, {0xff, 0xff, 0xff, 0x00}}, // DMA
+    {0xff47, {0xfc, 0xfc, 0xfc, 0xfc}}, // BGP
+    {0xff4a, {0x00, 0x00, 0x00, 0x00}}, // WY
+    {0xff4b, {0x00, 0x00, 0x00, 0x00}}, // WX
+    {0xffff, {0x00, 0x00, 0x00, 0x00}}, // IE
+};
+
+}
@@ -0,0 +1,97 @@
+#include "FlightRecorder.h"
+
+#include <fstream>
+#include <format>
+#include <stdexcept>
+
+#include "../Log/Log.h"
+
+static const char* reasonName(TriggerReason reason) {
+    switch (reason) {
+        case TRIGGER_PC:             return "pc";
+        case TRIGGER_UNKNOWN_OPCODE: return "unknown opcode";
+        case TRIGGER_WRITE:          return "write";
+        case TRIGGER_SERIAL:         return "serial";
+        default:                     return "manual";
+    }
+}
+
+FlightRecorder::FlightRecorder(size_t entries, const std::string& dumpPath) : path(dumpPath) {
+    if (entries == 0)
+        throw std::invalid_argument("FlightRecorder needs at least one entry");
+
+    size_t size = 1;
+    while (size < entries)
+        size <<= 1;
+    ring.resize(size);
+    mask = size - 1;
+}
+
+void FlightRecorder::addPcTrigger(uint16_t pc) {
+    pcTriggers.set(pc);
+}
+
+void FlightRecorder::addWriteTrigger(uint16_t addr) {
+    writeTriggers.set(addr);
+}
+
+void FlightRecorder::setSerialPattern(const std::string& pattern) {
+    serialPattern = pattern;
+    serialTail.clear();
+}
+
+void FlightRecorder::setPeek(std::function<uint8_t(uint16_t)> reader) {
+    peek = std::move(reader);
+}
+
+void FlightRecorder::serialByte(uint8_t byte) {
+    if (serialPattern.empty())
+        return;
+
+    serialTail.push_back(char(byte));
+    if (serialTail.size() > serialPattern.size())
+        serialTail.erase(0, 1);
+    if (serialTail == serialPattern)
+        trigger(TRIGGER_SERIAL, 0xff01);
+}
+
+void FlightRecorder::trigger(TriggerReason reason, uint16_t addr) {
+    if (fired)
+        return;
+    fired = true;
+
+    GB_LOG(Log::LEVEL_WARN, Log::CAT_CPU, "Flight recorder triggered (%s at %04x) after %llu instructions",
+           reasonName(reason), addr, (unsigned long long)count);
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        GB_LOG(Log::LEVEL_ERROR, Log::CAT_CPU, "Failed to open flight recorder dump %s", path.c_str());
+        return;
+    }
+    dump(out);
+}
+
+void FlightRecorder::rearm() {
+    fired = false;
+}
+
+bool FlightRecorder::hasFired() const {
+    return fired;
+}
+
+void FlightRecorder::dump(std::ostream& out) const {
+    const uint64_t n = count < ring.size() ? count : ring.size();
+    for (uint64_t i = count - n; i < count; i++) {
+        const FlightEntry& e = ring[i & mask];
+        uint8_t mem[4] = {0, 0, 0, 0};
+        if (peek) {
+            for (int j = 0; j < 4; j++)
+                mem[j] = peek(e.pc + j);
+        }
+
+        out << std::format(
+            "A:{:02X} F:{:02X} B:{:02X} C:{:02X} D:{:02X} E:{:02X} H:{:02X} L:{:02X} SP:{:04X} PC:{:04X} PCMEM:{:02X},{:02X},{:02X},{:02X}\n",
+            e.a, e.f, e.b, e.c, e.d, e.e, e.h, e.l, e.sp, e.pc,
+            mem[0], mem[1], mem[2], mem[3]);
+    }
+}
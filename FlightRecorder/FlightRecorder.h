@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitset>
+#include <functional>
+#include <ostream>
+
+// CPU state at the start of one instruction. PCMEM is not stored, it is read back from the bus
+// when the ring is dumped, which is exact for code running from ROM.
+struct FlightEntry {
+    uint8_t  a, f, b, c, d, e, h, l;
+    uint16_t sp, pc;
+};
+
+enum TriggerReason {
+    TRIGGER_PC,             // execution reached a watched address
+    TRIGGER_UNKNOWN_OPCODE, // insCycle/CBExtension hit their default branch
+    TRIGGER_WRITE,          // CPU wrote to a watched address
+    TRIGGER_SERIAL,         // serial output ended with the watched pattern
+    TRIGGER_MANUAL,
+};
+
+// Flight recorder for tracing long runs.
+// Every instruction overwrites one slot of a power-of-two ring, so recording costs a handful of
+// stores instead of a formatted trace line. When a trigger fires the ring is written out in
+// gameboy-doctor format, giving the instructions leading up to the failure without tracing
+// everything before it. Only the first trigger dumps until the recorder is rearmed.
+class FlightRecorder {
+private:
+    std::vector<FlightEntry> ring;
+    size_t   mask;
+    uint64_t count = 0; // instructions recorded
+
+    std::bitset<0x10000> pcTriggers;
+    std::bitset<0x10000> writeTriggers;
+    std::string serialPattern;
+    std::string serialTail; // last serialPattern.size() bytes sent
+
+    std::string path;
+    bool        fired = false;
+
+    std::function<uint8_t(uint16_t)> peek; // reads memory for PCMEM when dumping
+
+public:
+    // entries is rounded up to a power of two
+    FlightRecorder(size_t entries, const std::string& dumpPath);
+
+    FlightEntry& next() { return ring[count++ & mask]; }
+    bool pcTriggered(uint16_t pc) const    { return pcTriggers[pc]; }
+    bool writeTriggered(uint16_t a) const  { return writeTriggers[a]; }
+
+    void addPcTrigger(uint16_t pc);
+    void addWriteTrigger(uint16_t addr);
+    void setSerialPattern(const std::string& pattern);
+    void setPeek(std::function<uint8_t(uint16_t)> reader);
+
+    void serialByte(uint8_t byte);
+    void trigger(TriggerReason reason, uint16_t addr);
+    void rearm();
+    bool hasFired() const;
+
+    void dump(std::ostream& out) const; // oldest entry first
+};
@@ -0,0 +1,61 @@
+#include "InterruptController.h"
+
+InterruptController::InterruptController()
+    : memtype(MEM_TYPE_REG) {}
+
+void InterruptController::reset() {
+    IF = IE = 0;
+    pending = 0;
+}
+
+void InterruptController::copyStateFrom(const InterruptController& other) {
+    IF = other.IF;
+    IE = other.IE;
+    pending = other.pending;
+}
+
+void InterruptController::update() {
+    const bool wasIdle = pending == 0;
+    pending = IF & IE & 0x1f;
+
+    if (wasIdle && pending && wakeHook)
+        wakeHook();
+}
+
+void InterruptController::request(int source) {
+    IF |= 1 << source;
+    update();
+}
+
+void InterruptController::acknowledge(int source) {
+    IF &= ~(1 << source);
+    update();
+}
+
+void InterruptController::setWakeHook(std::function<void()> hook) {
+    wakeHook = std::move(hook);
+}
+
+uint8_t InterruptController::read(uint16_t addr) {
+    return addr == 0xff0f ? IF : IE;
+}
+
+bool InterruptController::write(uint16_t addr, uint8_t val) {
+    if (addr == 0xff0f)
+        IF = val;
+    else
+        IE = val;
+
+    update();
+    return true;
+}
+
+int InterruptController::getMemtype() {
+    return memtype;
+}
+
+int InterruptController::relativeUpdate(uint16_t addr, uint8_t val) {
+    uint8_t res = read(addr) + val;
+    write(addr, res);
+    return res;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "../memory/memory.h"
+
+// interrupt sources, in priority order (bit index in IF/IE)
+enum InterruptSource {
+    INT_VBLANK,
+    INT_STAT,
+    INT_TIMER,
+    INT_SERIAL,
+    INT_JOYPAD,
+    INT_COUNT,
+};
+
+// Owns IF (0xff0f) and IE (0xffff).
+// IF & IE is cached in `pending` whenever either side changes, so the CPU can test for a
+// serviceable interrupt with a single load instead of two bus reads per instruction.
+class InterruptController : public MemoryDevice {
+private:
+    uint8_t IF = 0;
+    uint8_t IE = 0;
+    const int memtype;
+    std::function<void()> wakeHook;
+
+    void update();
+
+public:
+    uint8_t pending = 0;
+
+    InterruptController();
+
+    void reset(); // clear IF and IE, the wake hook stays installed
+    void copyStateFrom(const InterruptController& other);
+
+    void request(int source);
+    void acknowledge(int source);
+    void setWakeHook(std::function<void()> hook); // called when pending goes from empty to non-empty
+
+    uint8_t read(uint16_t addr) override;
+    bool    write(uint16_t addr, uint8_t val) override;
+    int     getMemtype() override;
+    int     relativeUpdate(uint16_t addr, uint8_t val) override;
+};
@@ -0,0 +1,67 @@
+#include "Joypad.h"
+#include "../Log/Log.h"
+#include "../StateHash/StateHash.h"
+
+Joypad::Joypad(std::function<void()> requestInterrupt)
+    : requestInterrupt(std::move(requestInterrupt)), memtype(MEM_TYPE_REG) {}
+
+void Joypad::reset() {
+    select  = 0x30;
+    pressed = 0;
+}
+
+void Joypad::copyStateFrom(const Joypad& other) {
+    select  = other.select;
+    pressed = other.pressed;
+}
+
+uint64_t Joypad::stateHash() const {
+    return StateHash::mix(select, pressed);
+}
+
+uint8_t Joypad::lines() const {
+    uint8_t low = 0x0f;
+    if (!(select & 0x10))
+        low &= ~pressed & 0x0f;
+    if (!(select & 0x20))
+        low &= ~(pressed >> 4);
+    return low;
+}
+
+void Joypad::update(uint8_t before) {
+    if (before & ~lines()) {
+        GB_LOG(Log::LEVEL_TRACE, Log::CAT_INT, "Joypad line fell, P1 now %02x", read(0xff00));
+        requestInterrupt();
+    }
+}
+
+void Joypad::setButtons(uint8_t mask) {
+    const uint8_t before = lines();
+    pressed = mask;
+    update(before);
+}
+
+uint8_t Joypad::buttons() const {
+    return pressed;
+}
+
+uint8_t Joypad::read(uint16_t) {
+    return 0xc0 | select | lines();
+}
+
+bool Joypad::write(uint16_t, uint8_t val) {
+    const uint8_t before = lines();
+    select = val & 0x30;
+    update(before);
+    return true;
+}
+
+int Joypad::getMemtype() {
+    return memtype;
+}
+
+int Joypad::relativeUpdate(uint16_t addr, uint8_t val) {
+    uint8_t res = read(addr) + val;
+    write(addr, res);
+    return res;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "../memory/memory.h"
+
+// button bits of a Joypad mask; the low nibble is the d-pad, the high nibble the action buttons,
+// each in P1 line order
+enum JoypadButton {
+    BUTTON_RIGHT  = 0x01,
+    BUTTON_LEFT   = 0x02,
+    BUTTON_UP     = 0x04,
+    BUTTON_DOWN   = 0x08,
+    BUTTON_A      = 0x10,
+    BUTTON_B      = 0x20,
+    BUTTON_SELECT = 0x40,
+    BUTTON_START  = 0x80,
+};
+
+// P1 (0xff00).
+// The guest picks the d-pad (bit 4 low) and/or the action buttons (bit 5 low) and reads the
+// selected buttons back active-low in bits 0-3. A selected line falling from 1 to 0, either
+// because a button was pressed or because the guest selected a group with a button held,
+// requests the joypad interrupt.
+class Joypad : public MemoryDevice {
+private:
+    std::function<void()> requestInterrupt;
+
+    uint8_t   select  = 0x30; // P1 bits 4-5 as last written
+    uint8_t   pressed = 0;    // JoypadButton mask of the buttons held
+    const int memtype;
+
+    uint8_t lines() const; // P1 bits 0-3
+    void    update(uint8_t before);
+
+public:
+    Joypad(std::function<void()> requestInterrupt);
+
+    void    reset(); // nothing selected or held
+    void    copyStateFrom(const Joypad& other);
+    uint64_t stateHash() const; // of what copyStateFrom copies
+
+    void    setButtons(uint8_t mask); // JoypadButton bits of the buttons held from now on
+    uint8_t buttons() const;
+
+    uint8_t read(uint16_t addr) override;
+    bool    write(uint16_t addr, uint8_t val) override;
+    int     getMemtype() override;
+    int     relativeUpdate(uint16_t addr, uint8_t val) override;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../memory/memory.h"
+#include "../memory/watchpoints.h"
+
+namespace CPU {
+
+// Compile-time feature set for the core and the machine around it. Every config is its own
+// instantiation of the interpreter, so a feature that is off is compiled out instead of being
+// skipped by a runtime branch.
+// Diagnostic messages are not part of the config; they go through GB_LOG and its build-time
+// level threshold instead (see Log.h).
+template<class BusT, bool Tracing, bool Profiling, bool Recording>
+struct Config {
+    using BusType = BusT;
+    static constexpr bool tracing   = Tracing;   // gameboy-doctor state log per instruction
+    static constexpr bool profiling = Profiling; // Profiler hooks in insCycle
+    static constexpr bool recording = Recording; // FlightRecorder ring and triggers
+
+    // Superinstructions skip the per-instruction hooks, so only configs without any of them fuse
+    static constexpr bool fusion = !Tracing && !Profiling && !Recording && !BusT::DebugPolicy::enabled;
+};
+
+using ProductionConfig = Config<Bus, false, false, false>;
+using TraceConfig      = Config<Bus, true, false, false>;
+using ProfileConfig    = Config<Bus, false, true, false>;
+using RecordConfig     = Config<Bus, false, false, true>;
+using DebugConfig      = Config<DebugBus, true, true, true>;
+
+// Combinations of the hooks, still on the plain bus; only watchpoints need DebugConfig
+using TraceProfileConfig       = Config<Bus, true, true, false>;
+using TraceRecordConfig        = Config<Bus, true, false, true>;
+using ProfileRecordConfig      = Config<Bus, false, true, true>;
+using TraceProfileRecordConfig = Config<Bus, true, true, true>;
+
+}
+
+// Expands X once per config the machine factory can hand out, for explicit instantiations
+#define GB_FOR_EACH_CONFIG(X)         \
+    X(CPU::ProductionConfig)          \
+    X(CPU::TraceConfig)               \
+    X(CPU::ProfileConfig)             \
+    X(CPU::RecordConfig)              \
+    X(CPU::DebugConfig)               \
+    X(CPU::TraceProfileConfig)        \
+    X(CPU::TraceRecordConfig)         \
+    X(CPU::ProfileRecordConfig)       \
+    X(CPU::TraceProfileRecordConfig)
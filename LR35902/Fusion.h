@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Opcode sequences the core can execute as one superinstruction (see fusion.cpp)
+enum FusionKind {
+    FUSE_COPY_BYTE,    // LD A,(HL+) ; LD (DE),A ; INC DE
+    FUSE_DEC_JRNZ,     // DEC r ; JR NZ,e
+    FUSE_DEC16_JRNZ,   // DEC BC ; LD A,B ; OR C ; JR NZ,e
+    FUSE_LDH_CP_JR,    // LDH A,(n) ; CP n ; JR cc,e
+    FUSE_COPY_LOOP,    // LD A,(HL+) ; LD (DE),A ; INC DE ; DEC B/C or DEC BC ; LD A,B ; OR C ; JR NZ back
+    FUSE_FILL_LOOP,    // LD (HL+),A ; DEC r ; JR NZ back
+    FUSE_COUNT,
+};
+
+// First opcodes of the sequences above, so every other opcode skips the lookahead
+constexpr bool fusionHead(uint8_t opcode) {
+    switch (opcode) {
+        case 0x2a: case 0x22:
+        case 0x05: case 0x0d: case 0x15: case 0x1d: case 0x25: case 0x2d: case 0x3d:
+        case 0x0b:
+        case 0xf0:
+            return true;
+    }
+    return false;
+}
@@ -1,9 +1,12 @@
 #include "LR35902.h"
+#include "../StateHash/StateHash.h"
 
 namespace CPU {
 
-LR35902::LR35902(Bus& b)
+template<class Config>
+BasicLR35902<Config>::BasicLR35902(typename Config::BusType& b, InterruptController& i)
     : bus(b)
+    , irq(i)
     , AF(A, F)
     , BC(B, C)
     , DE(D, E)
@@ -13,52 +16,115 @@ LR35902::LR35902(Bus& b)
     , wait(0)
 {}
 
-int LR35902::read(const uint16_t& addr, int n) {
-    const int memtype = bus.getMemtype(addr);
-    switch(memtype) {
-        case MEM_TYPE_RAM: {
-            return bus.read(addr, n);
-            break;
-        }
-        case MEM_TYPE_ROM: {
-            return bus.read(addr, n);
-            break;
-        }
-        case MEM_TYPE_REG: {
-            return bus.read(addr, n);
-            break;
-        }
-        default: {
-            printf("Memtype %d does not exist\n", memtype);
-            break;
+template<class Config>
+void BasicLR35902<Config>::reset(const Registers& regs) {
+    setRegisters(regs);
+
+    IME = false;
+    pendingEnable = false;
+    halt = false;
+    haltBug = false;
+    wait = 0;
+}
+
+template<class Config>
+void BasicLR35902<Config>::setRegisters(const Registers& regs) {
+    A = regs.a; F = regs.f;
+    B = regs.b; C = regs.c;
+    D = regs.d; E = regs.e;
+    H = regs.h; L = regs.l;
+    SP = regs.sp;
+    PC = regs.pc;
+}
+
+template<class Config>
+bool BasicLR35902<Config>::simpleStep() const {
+    return !halt && !haltBug && !pendingEnable && !(IME && irq.pending);
+}
+
+template<class Config>
+Registers BasicLR35902<Config>::getRegisters() const {
+    return Registers{A.getVal(), F.getVal(), B.getVal(), C.getVal(),
+                     D.getVal(), E.getVal(), H.getVal(), L.getVal(), SP, PC};
+}
+
+template<class Config>
+void BasicLR35902<Config>::copyStateFrom(const BasicLR35902& other) {
+    reset(other.getRegisters());
+    IME = other.IME;
+    pendingEnable = other.pendingEnable;
+    halt = other.halt;
+    haltBug = other.haltBug;
+    wait = other.wait;
+}
+
+template<class Config>
+uint64_t BasicLR35902<Config>::stateHash() const {
+    const Registers r = getRegisters();
+    const uint8_t bytes[] = {r.a, r.f, r.b, r.c, r.d, r.e, r.h, r.l,
+                             uint8_t(r.sp), uint8_t(r.sp >> 8), uint8_t(r.pc), uint8_t(r.pc >> 8),
+                             IME, pendingEnable, halt, haltBug};
+    return StateHash::mix(StateHash::bytes(bytes, sizeof(bytes)), uint64_t(wait));
+}
+
+template<class Config>
+int BasicLR35902<Config>::read(const uint16_t& addr, int n) {
+    if constexpr (Log::LEVEL_DEBUG >= Log::threshold) {
+        const int memtype = bus.getMemtype(addr);
+        if (memtype != MEM_TYPE_RAM && memtype != MEM_TYPE_ROM && memtype != MEM_TYPE_REG)
+            GB_LOG(Log::LEVEL_DEBUG, Log::CAT_BUS, "Memtype %d does not exist", memtype);
+    }
+    if(bus.dmaLock) {
+        // Below 0xff00 the CPU sees an open bus while OAM DMA runs
+        int result = 0;
+        for(int i = 0; i < n; ++i) {
+            const uint16_t a = addr + i;
+            result |= (a >= 0xff00 ? this->bus.read(a) : 0xff) << (8 * i);
         }
+        return result;
     }
     return this->bus.read(addr, n);
 }
 
-uint8_t LR35902::write(uint16_t addr, uint8_t val) {
+template<class Config>
+uint8_t BasicLR35902<Config>::write(uint16_t addr, uint8_t val) {
+    if constexpr (Config::recording) { if(recorder && recorder->writeTriggered(addr)) recorder->trigger(TRIGGER_WRITE, addr); }
+    if(bus.dmaLock && addr < 0xff00) return 0;
     this->bus.write(addr, val);
     return 0;
 }
 
-uint8_t LR35902::write(uint16_t addr, Reg8& val) {
+template<class Config>
+uint8_t BasicLR35902<Config>::write(uint16_t addr, Reg8& val) {
+    if constexpr (Config::recording) { if(recorder && recorder->writeTriggered(addr)) recorder->trigger(TRIGGER_WRITE, addr); }
+    if(bus.dmaLock && addr < 0xff00) return 0;
     this->bus.write(addr, val.getVal());
     return 0;
 }
 
-uint8_t LR35902::write(Reg16& addr, Reg8& val) {
+template<class Config>
+uint8_t BasicLR35902<Config>::write(Reg16& addr, Reg8& val) {
+    if constexpr (Config::recording) { if(recorder && recorder->writeTriggered(addr.getVal())) recorder->trigger(TRIGGER_WRITE, addr.getVal()); }
+    if(bus.dmaLock && addr.getVal() < 0xff00) return 0;
     this->bus.write(addr.getVal(), val.getVal());
     return 0;
 }
 
-uint16_t LR35902::pc(int inc) {
+template<class Config>
+uint16_t BasicLR35902<Config>::pc(int inc) {
     uint16_t old = this->PC;
     this->PC += inc;
     return old;
 }
 
+template<class Config>
+uint16_t BasicLR35902<Config>::getPC() const {
+    return this->PC;
+}
+
 // Set flag
-void LR35902::f(uint8_t ZHNC, uint8_t ZHNCmask, uint8_t on, uint8_t off) {
+template<class Config>
+void BasicLR35902<Config>::f(uint8_t ZHNC, uint8_t ZHNCmask, uint8_t on, uint8_t off) {
     uint8_t oldBits = (this->F.getVal() >> 4) & 0xF;
     oldBits = (oldBits | ((ZHNC>>4) & ZHNCmask)) & ~(~(ZHNC>>4) & ZHNCmask);
     //printf("0x%02X, Old flag\n", F);
@@ -66,7 +132,8 @@ void LR35902::f(uint8_t ZHNC, uint8_t ZHNCmask, uint8_t on, uint8_t off) {
     //printf("0x%02X, New flag\n", F);
 }
 
-void LR35902::setRegisterStateJSON(json& data) {
+template<class Config>
+void BasicLR35902<Config>::setRegisterStateJSON(json& data) {
     A = data["a"].get<uint8_t>();
     B = data["b"].get<uint8_t>();
     C = data["c"].get<uint8_t>();
@@ -78,10 +145,11 @@ void LR35902::setRegisterStateJSON(json& data) {
     PC = data["pc"].get<uint16_t>();
     SP = data["sp"].get<uint16_t>();
 
-    printf("PC starts at %x\n", PC);
+    GB_LOG(Log::LEVEL_INFO, Log::CAT_CPU, "PC starts at %x", PC);
 }
 
-bool LR35902::compareRegisterStateJSON(json& state) {
+template<class Config>
+bool BasicLR35902<Config>::compareRegisterStateJSON(json& state) {
     if(A.getVal() != state["a"].get<uint8_t>()) { printf("%d != comparison value %d, comparison failed in register A\n", A.getVal(), state["a"].get<uint8_t>()); }
     if(B.getVal() != state["b"].get<uint8_t>()) { printf("%d != comparison value %d, comparison failed in register B\n", B.getVal(), state["b"].get<uint8_t>()); }
     if(C.getVal() != state["c"].get<uint8_t>()) { printf("%d != comparison value %d, comparison failed in register C\n", C.getVal(), state["c"].get<uint8_t>()); }
@@ -106,23 +174,32 @@ bool LR35902::compareRegisterStateJSON(json& state) {
     return false;
 }
 
-void LR35902::printState() {
+template<class Config>
+void BasicLR35902<Config>::printState() {
     printf("%s", std::format(
         "A:{:02X} F:{:02X} B:{:02X} C:{:02X} D:{:02X} E:{:02X} H:{:02X} L:{:02X} SP:{:04X} PC:{:04X} PCMEM:{:02X},{:02X},{:02X},{:02X}\n",
         A.getVal(), F.getVal(), B.getVal(), C.getVal(),
         D.getVal(), E.getVal(), H.getVal(), L.getVal(), SP, PC,
-        read(PC), read(PC + 1), read(PC + 2), read(PC + 3)
+        bus.peek(PC), bus.peek(PC + 1), bus.peek(PC + 2), bus.peek(PC + 3)
     )
     .c_str());
 }
 
-void LR35902::streamAppendState(std::ofstream& output) {
-    output << std::format(
+template<class Config>
+size_t BasicLR35902<Config>::streamAppendState(std::ofstream& output) requires Config::tracing {
+    std::string line = std::format(
         "A:{:02X} F:{:02X} B:{:02X} C:{:02X} D:{:02X} E:{:02X} H:{:02X} L:{:02X} SP:{:04X} PC:{:04X} PCMEM:{:02X},{:02X},{:02X},{:02X}\n",
         A.getVal(), F.getVal(), B.getVal(), C.getVal(),
         D.getVal(), E.getVal(), H.getVal(), L.getVal(), SP, PC,
-        read(PC), read(PC + 1), read(PC + 2), read(PC + 3)
+        bus.peek(PC), bus.peek(PC + 1), bus.peek(PC + 2), bus.peek(PC + 3)
     );
+    output << line;
+    bus.stats->traceBytes.inc(line.size());
+    return line.size();
 }
 
+#define INSTANTIATE(C) template class BasicLR35902<C>;
+GB_FOR_EACH_CONFIG(INSTANTIATE)
+#undef INSTANTIATE
+
 }
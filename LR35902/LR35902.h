@@ -5,16 +5,31 @@
 #include <format>
 
 #include "../memory/memory.h"
+#include "../memory/watchpoints.h"
+#include "Config.h"
+#include "Registers.h"
+#include "Fusion.h"
+#include "../InterruptController/InterruptController.h"
 #include "../Reg8/Reg8.h"
 #include "../Reg16/Reg16.h"
+#include "../Profiler/Profiler.h"
+#include "../FlightRecorder/FlightRecorder.h"
+#include "../Stats/Stats.h"
+#include "../Log/Log.h"
 #include "../json.hpp"
 using json = nlohmann::json;
 
 namespace CPU {
 
-class LR35902 {
+// The core is parameterized on a Config (see Config.h) that picks the bus type and which
+// debug features exist at all, so each config compiles into its own specialized interpreter
+template<class Config>
+class BasicLR35902 {
 private:
-    Bus& bus;
+    using BusT = typename Config::BusType;
+
+    BusT& bus;
+    InterruptController& irq;
     Reg8 A, B, C, D, E, F, H, L, dummy8;
     Reg16 AF, BC, DE, HL;
     bool IME = true;           // interrupt master enable
@@ -25,23 +40,42 @@ private:
     const int Hidx = 5;
     const int Cidx = 4;
 
+    void record(uint16_t opPC);
+    bool fuse(uint8_t opcode);
+    bool loop(uint8_t opcode);
+    bool fused(FusionKind kind, int instructions, int cycles);
+    void jr(bool taken);
+    Reg8& reg8(int idx);
+
 public:
     int wait;
     bool halt = false;
     bool haltBug = false;
-    LR35902(Bus& b);
+    Profiler* profiler = nullptr; // only consulted by profiling configs
+    FlightRecorder* recorder = nullptr; // only consulted by recording configs
+    int fuseBudget = 0; // m-cycles the core may run ahead of the clock for a superinstruction, 0 disables
+    BasicLR35902(BusT& b, InterruptController& i);
+    void reset(const Registers& regs); // drop HALT/EI/interrupt state and load regs
+    void setRegisters(const Registers& regs);
+    Registers getRegisters() const;
+    bool simpleStep() const; // the next instruction involves no interrupt, HALT or EI bookkeeping
+    void copyStateFrom(const BasicLR35902& other); // registers and HALT/EI/interrupt state
+    uint64_t stateHash() const; // of what copyStateFrom copies
     int read(const uint16_t& addr, int n = 1) ;
     uint8_t write(uint16_t addr, uint8_t val);
     uint8_t write(uint16_t addr, Reg8& val);
     uint8_t write(Reg16& addr, Reg8& val);
     uint16_t pc(int inc);
+    uint16_t getPC() const;
     void f(uint8_t ZHNC, uint8_t ZHNCmask, uint8_t on, uint8_t off);
     void setRegisterStateJSON(json& data);
     bool compareRegisterStateJSON(json& final);
     void printState();
-    void streamAppendState(std::ofstream& output); 
+    size_t streamAppendState(std::ofstream& output) requires Config::tracing;
     bool insCycle();
     void CBExtension();
 };
 
+using LR35902 = BasicLR35902<ProductionConfig>;
+
 }
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace CPU {
+
+// Architectural register file, for seeding and inspecting the core without going through JSON
+struct Registers {
+    uint8_t  a, f, b, c, d, e, h, l;
+    uint16_t sp, pc;
+};
+
+}
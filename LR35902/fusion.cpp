@@ -0,0 +1,218 @@
+#include "LR35902.h"
+
+#include <algorithm>
+
+// Superinstructions.
+// A handful of idioms make up most of what tight guest loops execute, so they are recognized at
+// decode time and run in one dispatch instead of one insCycle round (and wait countdown) each.
+// The handlers go through the same read/write/f paths as the switch, so registers, flags, memory,
+// bus statistics and the total cycle count are exactly those of the unfused sequence.
+//
+// What fusion changes is *when* the later instructions of a sequence happen: they run at the
+// cycle of the first one. That is only unobservable if
+//  - no device event (and so no interrupt) falls before the start of the last fused instruction,
+//    which is what fuseBudget bounds. The machine also caps it at the end of the current run() so
+//    state seen between slices is never ahead of the clock
+//  - the instructions after the first never touch the IO registers, whose values depend on time
+//  - no instruction in the sequence rewrites the code or the bank it is fetched from
+// Anything else falls through to the normal switch.
+
+template<class Config>
+CPU::Reg8& CPU::BasicLR35902<Config>::reg8(int idx) {
+    switch(idx) {
+        case 0: return B;
+        case 1: return C;
+        case 2: return D;
+        case 3: return E;
+        case 4: return H;
+        case 5: return L;
+        case 7: return A;
+    }
+    return dummy8;
+}
+
+// JR with an already evaluated condition, the same as the 0x18/0x20/0x28/0x30/0x38 cases
+template<class Config>
+void CPU::BasicLR35902<Config>::jr(bool taken) {
+    if(taken){
+        PC += int8_t(read(PC));
+        wait = 3;
+    } else {
+        wait = 2;
+    }
+    PC++;
+}
+
+template<class Config>
+bool CPU::BasicLR35902<Config>::fused(FusionKind kind, int instructions, int cycles) {
+    wait = cycles;
+    bus.stats->instructions.inc(instructions);
+    bus.stats->mcycles.inc(cycles);
+    bus.stats->fusions[kind].inc();
+    return true;
+}
+
+// Copy and fill loops, run as bulk transfers over the bus page table:
+//   loop: LD A,(HL+) ; LD (DE),A ; INC DE ; DEC B/C ; JR NZ,loop
+//   loop: LD A,(HL+) ; LD (DE),A ; INC DE ; DEC BC ; LD A,B ; OR C ; JR NZ,loop
+//   loop: LD (HL+),A ; DEC B/C/D/E ; JR NZ,loop
+// As many whole iterations run as fit in fuseBudget; the rest of a long loop is simply entered
+// again after the next event. The loop has to sit in ROM, so none of its stores can reach it,
+// and the bus refuses any transfer that would touch IO or another device with side effects.
+// The last iteration's DEC (or OR) is replayed on the real registers so the flags come out of
+// the same code as always.
+template<class Config>
+bool CPU::BasicLR35902<Config>::loop(uint8_t opcode) {
+    const uint16_t head = PC - 1;
+    if(head >= 0x7ff8)
+        return false;
+
+    bool wide = false;   // 16-bit BC counter
+    int  counter;        // reg8 index of the 8-bit counter
+    int  length;         // bytes of code
+    int  instructions;   // per iteration
+    int  cycles;         // per iteration, with the JR taken
+    if(opcode == 0x2a) {
+        if(bus.peek(PC) != 0x12 || bus.peek(PC + 1) != 0x13)
+            return false;
+        const uint8_t dec = bus.peek(PC + 2);
+        if((dec == 0x05 || dec == 0x0d) && bus.peek(PC + 3) == 0x20 && bus.peek(PC + 4) == 0xfa) {
+            counter = dec >> 3; length = 6; instructions = 5; cycles = 2 + 2 + 2 + 1 + 3;
+        } else if(dec == 0x0b && bus.peek(PC + 3) == 0x78 && bus.peek(PC + 4) == 0xb1 &&
+                  bus.peek(PC + 5) == 0x20 && bus.peek(PC + 6) == 0xf8) {
+            wide = true; counter = 0; length = 8; instructions = 7; cycles = 2 + 2 + 2 + 2 + 1 + 1 + 3;
+        } else {
+            return false;
+        }
+    } else {
+        const uint8_t dec = bus.peek(PC);
+        if((dec != 0x05 && dec != 0x0d && dec != 0x15 && dec != 0x1d) || bus.peek(PC + 1) != 0x20 || bus.peek(PC + 2) != 0xfc)
+            return false;
+        counter = dec >> 3; length = 4; instructions = 3; cycles = 2 + 1 + 3;
+    }
+
+    // Iterations until the counter hits zero, and how many of them may run now. The last
+    // instruction of k iterations starts 3 m-cycles before their end, taken JR or not
+    const uint32_t total = wide ? (BC.getVal() ? BC.getVal() : 0x10000) : (reg8(counter).getVal() ? reg8(counter).getVal() : 0x100);
+    const uint32_t n = std::min<uint32_t>(total, (uint32_t(fuseBudget) + 3) / cycles);
+    if(n == 0)
+        return false;
+
+    const uint16_t hl = HL.getVal();
+    const uint16_t de = DE.getVal();
+    if(opcode == 0x2a ? !bus.copyBlock(de, hl, n) : !bus.fillBlock(hl, A.getVal(), n))
+        return false;
+
+    // Memory is done; replay the register effects of n iterations
+    const bool done = n == total;
+    HL = uint16_t(hl + n);
+    if(opcode == 0x2a) {
+        DE = uint16_t(de + n);
+        A = bus.peek(uint16_t(de + n - 1)); // the last byte stored
+    }
+    if(wide) {
+        BC = uint16_t(BC.getVal() - n);
+        A = B;
+        f(A |= C, 0b1000, 0b00000, 0b0111);
+    } else {
+        Reg8& r = reg8(counter);
+        r = uint8_t(r.getVal() - (n - 1));
+        f(r -= 1, 0b1010, 0b0100, 0b00000);
+    }
+    PC = done ? head + length : head;
+
+    // Opcode fetches but the one insCycle already did, plus the offset read of every taken JR
+    bus.countReads(head, uint64_t(n) * instructions - 1 + n - done);
+    wait = n * cycles - done;
+    bus.stats->instructions.inc(uint64_t(n) * instructions);
+    bus.stats->mcycles.inc(wait);
+    bus.stats->fusions[opcode == 0x2a ? FUSE_COPY_LOOP : FUSE_FILL_LOOP].inc();
+    return true;
+}
+
+// Called with the first opcode fetched and PC past it. Either runs the whole sequence and
+// returns true, or returns false without having changed anything
+template<class Config>
+bool CPU::BasicLR35902<Config>::fuse(uint8_t opcode) {
+    // No sequence is longer than 6 bytes; keep all of them clear of the IO registers
+    if(PC >= 0xfef8)
+        return false;
+
+    switch(opcode) {
+        case 0x22: return loop(opcode);
+
+        case 0x2a: { /* LD A,(HL+) ; LD (DE),A ; INC DE */
+            if(loop(opcode))
+                return true;
+            if(fuseBudget < 4 || bus.peek(PC) != 0x12 || bus.peek(PC + 1) != 0x13)
+                return false;
+            // The store must hit plain memory (not IO, not an MBC register) and not the INC DE
+            uint16_t dst = DE.getVal();
+            if(dst < 0x8000 || dst >= 0xff00 || dst == PC + 1)
+                return false;
+
+            A = read(HL++);
+            read(PC++);
+            write(DE, A);
+            read(PC++);
+            ++DE;
+            return fused(FUSE_COPY_BYTE, 3, 2 + 2 + 2);
+        }
+
+        case 0x05: case 0x0d: case 0x15: case 0x1d: case 0x25: case 0x2d: case 0x3d: { /* DEC r ; JR NZ,e */
+            if(fuseBudget < 1 || bus.peek(PC) != 0x20)
+                return false;
+
+            f(reg8(opcode >> 3) -= 1, 0b1010, 0b0100, 0b00000);
+            read(PC++);
+            jr(!F.getBit(Zidx));
+            return fused(FUSE_DEC_JRNZ, 2, 1 + wait);
+        }
+
+        case 0x0b: { /* DEC BC ; LD A,B ; OR C ; JR NZ,e */
+            if(fuseBudget < 4 || bus.peek(PC) != 0x78 || bus.peek(PC + 1) != 0xb1 || bus.peek(PC + 2) != 0x20)
+                return false;
+
+            --BC;
+            read(PC++);
+            A = B;
+            read(PC++);
+            f(A |= C, 0b1000, 0b00000, 0b0111);
+            read(PC++);
+            jr(!F.getBit(Zidx));
+            return fused(FUSE_DEC16_JRNZ, 4, 2 + 1 + 1 + wait);
+        }
+
+        case 0xf0: { /* LDH A,(n) ; CP n ; JR cc,e */
+            const uint8_t branch = bus.peek(PC + 3);
+            if(fuseBudget < 5 || bus.peek(PC + 1) != 0xfe || (branch & 0xe7) != 0x20)
+                return false;
+
+            uint8_t offset = read(PC);
+            PC += 1;
+            A = read(0xFF00u | offset);
+
+            read(PC++);
+            uint8_t store = A.getVal();
+            f(A -= read(pc(1)), 0b1011, 0b0100, 0b00000);
+            A = store;
+
+            read(PC++);
+            bool taken;
+            switch((branch >> 3) & 3) {
+                case 0:  taken = !F.getBit(Zidx); break; /* NZ */
+                case 1:  taken =  F.getBit(Zidx); break; /* Z */
+                case 2:  taken = !F.getBit(Cidx); break; /* NC */
+                default: taken =  F.getBit(Cidx); break; /* C */
+            }
+            jr(taken);
+            return fused(FUSE_LDH_CP_JR, 3, 3 + 2 + wait);
+        }
+    }
+    return false;
+}
+
+#define INSTANTIATE(C) \
+    template bool CPU::BasicLR35902<C>::fuse(uint8_t opcode);
+GB_FOR_EACH_CONFIG(INSTANTIATE)
+#undef INSTANTIATE
@@ -1,43 +1,63 @@
 #include "LR35902.h"
 
-bool CPU::LR35902::insCycle() {
+// Fill the next flight recorder slot with the state the instruction at opPC starts from
+template<class Config>
+void CPU::BasicLR35902<Config>::record(uint16_t opPC) {
+    FlightEntry& e = recorder->next();
+    e.a = A.getVal(); e.f = F.getVal();
+    e.b = B.getVal(); e.c = C.getVal();
+    e.d = D.getVal(); e.e = E.getVal();
+    e.h = H.getVal(); e.l = L.getVal();
+    e.sp = SP; e.pc = opPC;
+
+    if(recorder->pcTriggered(opPC)) recorder->trigger(TRIGGER_PC, opPC);
+}
+
+template<class Config>
+bool CPU::BasicLR35902<Config>::insCycle() {
     // Cooldown to simulate machine cycles
     wait -= 1;
     if(wait > 0){
         return false;
     }
 
-    // Perform interrupt handling
-    uint8_t IF = read(0xff0f);
-    uint8_t IE = read(0xffff);
-    uint8_t pending = IF & IE;
+    // Perform interrupt handling. Any pending interrupt ends HALT, but is only serviced with IME set
+    if(irq.pending) {
+        halt = false;
 
-    if(IME && (pending != 0)) {
-        IME = false;
+        if(IME) {
+            IME = false;
 
-        // Highest priority bit
-        int bit = __builtin_ctz(pending);
-        printf("Interrupt handling begins for bit %d at 0xff0f\n", bit);
+            // Highest priority bit
+            int bit = __builtin_ctz(irq.pending);
+            GB_LOG(Log::LEVEL_DEBUG, Log::CAT_INT, "Interrupt handling begins for bit %d at 0xff0f", bit);
 
-        // Clear the current IF bit
-        write(0xff0f, IF & ~(1 << bit));
+            // Clear the current IF bit
+            irq.acknowledge(bit);
 
-        // Push PC
-        write(--SP, (PC >> 8) & 0xff);
-        write(--SP, PC & 0xff);
+            // Push PC
+            write(--SP, (PC >> 8) & 0xff);
+            write(--SP, PC & 0xff);
 
-        // Jump to ISR
-        PC = 0x40 + 8*bit;
+            // Jump to ISR
+            PC = 0x40 + 8*bit;
 
-        wait = 5; // This takes 5 cycles
-        return false;
+            wait = 5; // This takes 5 cycles
+            bus.stats->interrupts[bit].inc();
+            bus.stats->mcycles.inc(wait);
+            if constexpr (Config::profiling) { if(profiler) profiler->interrupt(PC, wait); }
+            return false;
+        }
     }
 
     if(halt) {
+        bus.stats->haltedCycles.inc();
+        bus.stats->mcycles.inc();
         return false;
     }
 
     // Load one opcode from memory. It's important to keep in mind that the PC has incremented when implementing/editing opcodes.
+    uint16_t opPC = haltBug ? PC - 1 : PC;
     uint8_t opcode;
     if(haltBug) {
         haltBug = false;
@@ -45,6 +65,11 @@ bool CPU::LR35902::insCycle() {
     } else {
         opcode = read(PC++);
     }
+    if constexpr (Config::BusType::DebugPolicy::enabled) bus.debug.check(opPC, WATCH_EXEC, opcode);
+    if constexpr (Config::recording) { if(recorder) record(opPC); }
+    if constexpr (Config::fusion) {
+        if(fuseBudget > 0 && fusionHead(opcode) && !pendingEnable && fuse(opcode)) return true;
+    }
 
     // Precompiled jumptable for all instructions
     wait = 1; // Most 1-byte instructions only need 1 m-cycle
@@ -57,7 +82,7 @@ bool CPU::LR35902::insCycle() {
         case 0x03: { wait = 2; ++BC;                                   break; } 
         case 0x04: { f(B += 1, 0b1010, 0b00000, 0b0100);      break; } /* INC B        1 4     Z0H- */
         case 0x05: { f(B -= 1, 0b1010, 0b0100, 0b00000);      break; } 
-        case 0x06: { wait = 2; B = bus.read(pc(1));                    break; } 
+        case 0x06: { wait = 2; B = read(pc(1));                        break; } 
         case 0x07: { f(A.RLC(), 0b00001, 0b00000, 0b1110);     break; } 
         case 0x08: {
             uint16_t addr = read(pc(2), 2);
@@ -273,12 +298,9 @@ bool CPU::LR35902::insCycle() {
         case 0x74: { wait = 2; write(HL, H); break;} 
         case 0x75: { wait = 2; write(HL, L); break;} 
         case 0x76: {
-            uint8_t IF = read(0xFF0F);
-            uint8_t IE = read(0xFFFF);
-            bool pendingInterrupt = (IF & IE) != 0;
-            printf("HALT\n");
+            GB_LOG(Log::LEVEL_DEBUG, Log::CAT_CPU, "HALT");
 
-            if (!IME && pendingInterrupt) {
+            if (!IME && irq.pending) {
                 // HALT bug triggers
                 halt = false;
                 haltBug = true;
@@ -658,7 +680,7 @@ bool CPU::LR35902::insCycle() {
         }
         case 0xf1: { wait = 3; AF = (read(SP + 1) << 8) | read(SP); F = F.getVal() & 0xf0; SP += 2; break; }
         case 0xf2: { A = read(0xff00 + C.getVal()); break; }
-        case 0xf3: { IME = false; pendingEnable = false; return true; }
+        case 0xf3: { IME = false; pendingEnable = false; break; }
         case 0xf4: { f(B.RLC(), 0b1001, 0b0000, 0b0110); break; }
         case 0xf5: { wait = 4; write(--SP, A); write(--SP, F); break; }
         case 0xf6: { wait = 2; f(A |= read(pc(1)), 0b1000, 0b00000, 0b0111);                 break;} /* OR */
@@ -681,7 +703,7 @@ bool CPU::LR35902::insCycle() {
         }
         case 0xf9: { wait = 2; SP = HL.getVal(); break; }
         case 0xfa: { wait = 4; A = read(read(PC) | (read(PC + 1) << 8)); PC += 2; break; }
-        case 0xfb: { pendingEnable = true; return true; }
+        case 0xfb: { pendingEnable = true; break; }
         case 0xfc: { f(B.RLC(), 0b1001, 0b0000, 0b0110); break; }
         case 0xfd: { f(B.RLC(), 0b1001, 0b0000, 0b0110); break; }
         case 0xfe: { wait = 2; uint8_t store = A.getVal(); f(A -= read(pc(1)), 0b1011, 0b0100, 0b00000); A = store; break;} /* CP */
@@ -693,18 +715,28 @@ bool CPU::LR35902::insCycle() {
             break;
         }
 
-        default: { printf("Unknown opcode - %d\n", opcode);   break; } /* Unknown opcode */
+        default: { /* Unknown opcode */
+            GB_LOG(Log::LEVEL_WARN, Log::CAT_CPU, "Unknown opcode - %d", opcode);
+            if constexpr (Config::recording) { if(recorder) recorder->trigger(TRIGGER_UNKNOWN_OPCODE, opPC); }
+            break;
+        }
     }
 
-    if(pendingEnable) {
+    // EI only takes effect after the instruction that follows it
+    if(pendingEnable && opcode != 0xfb) {
         pendingEnable = false;
         IME = true;
     }
 
+    bus.stats->instructions.inc();
+    bus.stats->mcycles.inc(wait);
+    if constexpr (Config::profiling) { if(profiler) profiler->instruction(opPC, opcode, PC, wait); }
+
     return true;
 };
 
-void CPU::LR35902::CBExtension() {
+template<class Config>
+void CPU::BasicLR35902<Config>::CBExtension() {
     uint8_t postfix = read(PC++);
     wait = 2; // In almost all cases we need 2 m-cycles
 
@@ -1026,6 +1058,16 @@ void CPU::LR35902::CBExtension() {
         case 0xfe: { wait = 4; write(HL.getVal(), read(HL.getVal()) | (1 << 7)); break; }
         case 0xff: { A.setBit(7); break; }
 
-        default: { printf("Unknown CB postfix\n"); break; }
+        default: {
+            GB_LOG(Log::LEVEL_WARN, Log::CAT_CPU, "Unknown CB postfix");
+            if constexpr (Config::recording) { if(recorder) recorder->trigger(TRIGGER_UNKNOWN_OPCODE, PC - 2); }
+            break;
+        }
     }
 }
+
+#define INSTANTIATE(C)                                \
+    template bool CPU::BasicLR35902<C>::insCycle();   \
+    template void CPU::BasicLR35902<C>::CBExtension();
+GB_FOR_EACH_CONFIG(INSTANTIATE)
+#undef INSTANTIATE
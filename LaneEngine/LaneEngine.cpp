@@ -0,0 +1,221 @@
+#include "LaneEngine.h"
+#include "../Stats/Stats.h"
+
+namespace {
+
+using U8 = LaneEngine::U8;
+
+constexpr int REG_A = 7;
+
+// comparisons produce 0 / -1 lanes of a signed type
+template<class V>
+U8 m8(V v) {
+    return (U8)v;
+}
+
+U8 select(U8 mask, U8 a, U8 b) {
+    return (a & mask) | (b & ~mask);
+}
+
+// Vector form of BasicLR35902::f(): bits in mask come from the computed flags, then on/off
+// are forced. All four arguments are in ZNHC nibble order, and the low nibble of F is cleared.
+U8 applyFlags(U8 F, U8 computed, uint8_t mask, uint8_t on, uint8_t off) {
+    U8 oldBits = F >> 4;
+    U8 v = computed >> 4;
+    oldBits = (oldBits | (v & mask)) & ~(~v & mask);
+    return ((oldBits | on) & uint8_t(~off)) << 4;
+}
+
+U8 zero(U8 v) {
+    return m8(v == 0) & 0x80;
+}
+
+}
+
+LaneEngine::LaneEngine() {
+    for (auto& lane : lanes) {
+        lane = std::make_unique<Lane>();
+        lane->bus.mapMemory(0x0000, 0xffff, MEM_TYPE_RAM);
+    }
+}
+
+void LaneEngine::setLane(int lane, const CPU::Registers& r) {
+    regs[0][lane] = r.b; regs[1][lane] = r.c;
+    regs[2][lane] = r.d; regs[3][lane] = r.e;
+    regs[4][lane] = r.h; regs[5][lane] = r.l;
+    regs[REG_A][lane] = r.a;
+    F[lane] = r.f;
+    sp[lane] = r.sp;
+    pc[lane] = r.pc;
+    lanes[lane]->core.setRegisters(r);
+}
+
+CPU::Registers LaneEngine::getLane(int lane) const {
+    return CPU::Registers{regs[REG_A][lane], F[lane], regs[0][lane], regs[1][lane],
+                          regs[2][lane], regs[3][lane], regs[4][lane], regs[5][lane],
+                          sp[lane], pc[lane]};
+}
+
+Bus& LaneEngine::bus(int lane) {
+    return lanes[lane]->bus;
+}
+
+CPU::LR35902& LaneEngine::core(int lane) {
+    return lanes[lane]->core;
+}
+
+bool LaneEngine::vectorizable(uint8_t op) {
+    if (op == 0x00)
+        return true;
+    if (op < 0x40) // INC r / DEC r
+        return ((op & 7) == 4 || (op & 7) == 5) && ((op >> 3) & 7) != 6;
+    if (op < 0x80) // LD r, r' (the (HL) forms and HALT touch memory or CPU state)
+        return (op & 7) != 6 && ((op >> 3) & 7) != 6;
+    if (op < 0xc0) // ALU A, r
+        return (op & 7) != 6;
+    return false;
+}
+
+void LaneEngine::step() {
+    std::array<uint8_t, LANES> ops;
+    std::array<bool, LANES>    vec;
+
+    for (int i = 0; i < LANES; i++) {
+        Lane& lane = *lanes[i];
+        vec[i] = lane.core.simpleStep();
+        if (vec[i]) {
+            ops[i] = lane.bus.peek(pc[i]);
+            vec[i] = vectorizable(ops[i]);
+        }
+        if (!vec[i])
+            stepScalar(i);
+    }
+
+    // One masked pass per distinct opcode among the vector lanes
+    std::array<bool, LANES> done{};
+    for (int i = 0; i < LANES; i++) {
+        if (!vec[i] || done[i])
+            continue;
+
+        U8 mask = {};
+        for (int j = i; j < LANES; j++) {
+            if (vec[j] && ops[j] == ops[i]) {
+                mask[j] = 0xff;
+                done[j] = true;
+            }
+        }
+        stepVector(ops[i], mask);
+    }
+
+    for (int i = 0; i < LANES; i++) {
+        if (!vec[i])
+            continue;
+        pc[i]++;
+        Stats::Counters& stats = *lanes[i]->bus.stats;
+        stats.busReads[MEM_TYPE_RAM].inc(); // the opcode fetch
+        stats.instructions.inc();
+        stats.mcycles.inc();
+        vectorSteps++;
+    }
+}
+
+void LaneEngine::stepScalar(int i) {
+    Lane& lane = *lanes[i];
+    lane.core.setRegisters(getLane(i));
+    lane.core.wait = 0;
+    lane.core.insCycle();
+
+    CPU::Registers r = lane.core.getRegisters();
+    regs[0][i] = r.b; regs[1][i] = r.c;
+    regs[2][i] = r.d; regs[3][i] = r.e;
+    regs[4][i] = r.h; regs[5][i] = r.l;
+    regs[REG_A][i] = r.a;
+    F[i] = r.f;
+    sp[i] = r.sp;
+    pc[i] = r.pc;
+    scalarSteps++;
+}
+
+void LaneEngine::stepVector(uint8_t op, U8 mask) {
+    if (op == 0x00)
+        return;
+
+    // LD r, r'
+    if (op >= 0x40 && op < 0x80) {
+        U8& dst = regs[(op >> 3) & 7];
+        dst = select(mask, regs[op & 7], dst);
+        return;
+    }
+
+    // INC r / DEC r
+    if (op < 0x40) {
+        U8& r = regs[(op >> 3) & 7];
+        U8 res, fl;
+        if ((op & 7) == 4) {
+            res = r + 1;
+            fl = zero(res) | (m8((r & 0xf) == 0xf) & 0x20) | (m8(r == 0xff) & 0x10);
+            F = select(mask, applyFlags(F, fl, 0b1010, 0b0000, 0b0100), F);
+        } else {
+            res = r - 1;
+            fl = zero(res) | 0x40 | (m8((r & 0xf) == 0) & 0x20) | (m8(r == 0) & 0x10);
+            F = select(mask, applyFlags(F, fl, 0b1010, 0b0100, 0b0000), F);
+        }
+        r = select(mask, res, r);
+        return;
+    }
+
+    // ALU A, r
+    U8& A = regs[REG_A];
+    const U8 a = A;
+    const U8 b = regs[op & 7];
+    const U8 carry = (F >> 4) & 1;
+    U8 res = a, newF = F;
+
+    switch ((op >> 3) & 7) {
+        case 0: { // ADD
+            res = a + b;
+            U8 fl = zero(res) | (m8((a & 0xf) + (b & 0xf) > 0xf) & 0x20) | (m8(res < a) & 0x10);
+            newF = applyFlags(F, fl, 0b1011, 0b0000, 0b0100);
+            break;
+        }
+        case 1: { // ADC
+            U8 t = a + b;
+            res = t + carry;
+            U8 c = m8(t < a) | m8(res < t);
+            newF = zero(res) | (m8((a & 0xf) + (b & 0xf) + carry > 0xf) & 0x20) | (c & 0x10);
+            break;
+        }
+        case 2: // SUB
+        case 7: { // CP
+            res = a - b;
+            U8 fl = zero(res) | 0x40 | (m8((a & 0xf) < (b & 0xf)) & 0x20) | (m8(a < b) & 0x10);
+            newF = applyFlags(F, fl, 0b1011, 0b0100, 0b0000);
+            if (((op >> 3) & 7) == 7)
+                res = a;
+            break;
+        }
+        case 3: { // SBC
+            res = a - b - carry;
+            U8 cin = m8(carry != 0);
+            U8 h = m8((a & 0xf) < (b & 0xf)) | (m8((a & 0xf) == (b & 0xf)) & cin);
+            U8 c = m8(a < b) | (m8(a == b) & cin);
+            newF = zero(res) | 0x40 | (h & 0x20) | (c & 0x10);
+            break;
+        }
+        case 4: // AND
+            res = a & b;
+            newF = applyFlags(F, zero(res), 0b1000, 0b0010, 0b0101);
+            break;
+        case 5: // XOR
+            res = a ^ b;
+            newF = applyFlags(F, zero(res), 0b1000, 0b0000, 0b0111);
+            break;
+        case 6: // OR
+            res = a | b;
+            newF = applyFlags(F, zero(res), 0b1000, 0b0000, 0b0111);
+            break;
+    }
+
+    A = select(mask, res, A);
+    F = select(mask, newF, F);
+}
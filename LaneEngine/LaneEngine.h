@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <memory>
+
+#include "../memory/memory.h"
+#include "../InterruptController/InterruptController.h"
+#include "../LR35902/LR35902.h"
+#include "../LR35902/Registers.h"
+
+// Lanes per engine. 16 fills an SSE/NEON register, 32 an AVX2 one and 64 an AVX-512 one;
+// the code is written with GCC vector extensions, so -march picks the instructions.
+#ifndef GB_LANES
+#define GB_LANES 16
+#endif
+
+// Experimental multi-instance interpreter.
+// Runs LANES independent CPUs, each with its own flat 64KB of memory, one instruction per lane
+// per step(), like the SingleStepTests harness does. Registers are kept structure-of-arrays;
+// lanes whose next opcode is the same register-only instruction (LD r,r', INC/DEC r, the 8-bit
+// ALU ops on registers) are executed together with masked vector operations, everything else
+// goes through the lane's scalar core and insCycle. Results are bit-identical to the scalar core.
+class LaneEngine {
+public:
+    static constexpr int LANES = GB_LANES;
+
+    typedef uint8_t U8 __attribute__((vector_size(LANES)));
+
+private:
+    struct Lane {
+        Bus                 bus;
+        InterruptController irq;
+        CPU::LR35902        core{bus, irq};
+    };
+
+    std::array<std::unique_ptr<Lane>, LANES> lanes;
+
+    // B C D E H L - A, indexed like the register field of an opcode (6 is (HL))
+    U8 regs[8] = {};
+    U8 F = {};
+    std::array<uint16_t, LANES> sp{}, pc{};
+
+    void stepVector(uint8_t op, U8 mask);
+    void stepScalar(int lane);
+
+public:
+    uint64_t vectorSteps = 0; // lane-instructions executed in vector form
+    uint64_t scalarSteps = 0; // lane-steps that fell back to insCycle
+
+    LaneEngine();
+
+    static bool vectorizable(uint8_t op); // run in vector form when the lane needs no interrupt bookkeeping
+
+    void           setLane(int lane, const CPU::Registers& r); // IME/HALT state is left alone
+    CPU::Registers getLane(int lane) const;
+    Bus&           bus(int lane);
+    CPU::LR35902&  core(int lane); // only in sync with getLane() between steps for its IME etc.
+
+    void step();
+};
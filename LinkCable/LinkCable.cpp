@@ -0,0 +1,109 @@
+#include "LinkCable.h"
+
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+LinkCable::LinkCable(Machine& a, Machine& b, uint64_t quantum)
+    : ends{&a, &b}, quantum(quantum) {
+    if (&a == &b)
+        throw std::invalid_argument("Cannot link a machine to itself");
+    if (quantum == 0)
+        throw std::invalid_argument("Link quantum must be at least one cycle");
+    a.serial().setLinked(true);
+    b.serial().setLinked(true);
+}
+
+LinkCable::~LinkCable() {
+    ends[0]->serial().setLinked(false);
+    ends[1]->serial().setLinked(false);
+}
+
+// An internal-clock transfer that is due ends with whatever the other side holds in SB if that
+// side waits on the external clock, or with 0xff as if nothing was plugged in
+void LinkCable::exchange() {
+    const uint64_t now = ends[0]->scheduler().now;
+    for (int i = 0; i < 2; i++) {
+        Serial& port = ends[i]->serial();
+        Serial& peer = ends[1 - i]->serial();
+        if (!port.transferring() || !port.internalClock() || port.completion() > now)
+            continue;
+
+        if (peer.transferring() && !peer.internalClock())
+            port.finish(peer.finish(port.read(0xff01)));
+        else
+            port.finish(0xff);
+    }
+}
+
+// Barrier completion, with both machines stopped at target (or stopping for good)
+void LinkCable::meet() {
+    if (target == DONE)
+        return;
+    meetings++;
+    exchange();
+
+    if (error || target >= until)
+        target = DONE;
+    else
+        plan();
+}
+
+// Next meeting: a quantum on, or the end of a transfer in flight if that comes first
+void LinkCable::plan() {
+    uint64_t next = std::min(target + quantum, until);
+    for (Machine* end : ends) {
+        const Serial& port = end->serial();
+        if (port.transferring() && port.internalClock() && port.completion() > target)
+            next = std::min(next, port.completion());
+    }
+    target = next;
+}
+
+void LinkCable::drive(Machine& machine) {
+    try {
+        while (target != DONE) {
+            const uint64_t t = target;
+            while (machine.run(t) < t) {
+                if (Watchpoints* wp = machine.watchpoints())
+                    wp->hit = false;
+            }
+            sync->arrive_and_wait();
+        }
+    } catch (...) {
+        // Leave the barrier so the other side finishes alone; meet() stops at the next meeting
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+        sync->arrive_and_drop();
+    }
+}
+
+uint64_t LinkCable::run(uint64_t until) {
+    const uint64_t now = ends[0]->scheduler().now;
+    if (ends[1]->scheduler().now != now)
+        throw std::invalid_argument("Linked machines must start at the same cycle");
+    if (until <= now)
+        return now;
+
+    this->until = until;
+    target = now;
+    error = nullptr;
+    exchange();
+    plan();
+    sync.emplace(2, Completion{this});
+
+    std::thread second([this] { drive(*ends[1]); });
+    drive(*ends[0]);
+    second.join();
+
+    if (error)
+        std::rethrow_exception(error);
+    return ends[0]->scheduler().now;
+}
+
+uint64_t LinkCable::syncs() const {
+    return meetings;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <barrier>
+#include <optional>
+#include <mutex>
+#include <exception>
+#include <functional>
+
+#include "../Machine/Machine.h"
+
+// Serial link between two machines, each emulated on its own thread.
+// The threads never lock per cycle. Both machines run a quantum of T-cycles independently, meet
+// at a barrier, and the barrier's completion step (running while both threads wait) ends any
+// transfer that is due by exchanging the two SB registers, then picks the next meeting point.
+// An internal-clock transfer takes at least Serial::MIN_TRANSFER_CYCLES, so with quanta no
+// longer than that every transfer is seen at a meeting before it ends and the next quantum is
+// shrunk to end exactly on it: the exchange and both interrupts happen on the right cycle.
+// Longer quanta trade that for fewer meetings; a transfer that starts and ends within one
+// quantum completes at the meeting after its end, up to a quantum late. Quanta only shrink while
+// a transfer is in flight. A DIV write during a transfer can pull its end up to half a bit
+// earlier than the meeting already planned for it, and it then completes at that meeting.
+class LinkCable {
+private:
+    static constexpr uint64_t DONE = UINT64_MAX;
+
+    Machine* ends[2];
+    uint64_t quantum;
+    uint64_t until  = 0;
+    uint64_t target = 0; // where both machines meet next
+    uint64_t meetings = 0;
+    std::mutex         errorMutex;
+    std::exception_ptr error;
+
+    struct Completion {
+        LinkCable* cable;
+        void operator()() noexcept { cable->meet(); }
+    };
+    std::optional<std::barrier<Completion>> sync; // one per run, a failed run leaves it short a thread
+
+    void meet();
+    void plan();
+    void exchange();
+    void drive(Machine& machine);
+
+public:
+    LinkCable(Machine& a, Machine& b, uint64_t quantum = Serial::MIN_TRANSFER_CYCLES);
+    ~LinkCable(); // unplugs both ends
+
+    LinkCable(const LinkCable&) = delete;
+    LinkCable& operator=(const LinkCable&) = delete;
+
+    // Run both machines to until, the second one on a thread of its own. Both clocks must agree
+    // when called. Watchpoints do not stop a linked run.
+    uint64_t run(uint64_t until);
+    uint64_t syncs() const; // barrier meetings so far
+};
@@ -0,0 +1,176 @@
+#include "Log.h"
+
+#include <cstdarg>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+namespace Log {
+
+struct Record {
+    uint8_t level;
+    uint8_t category;
+    char    msg[126];
+};
+
+// Single-producer single-consumer ring: the owning thread pushes, the drain thread pops
+class Ring {
+private:
+    static constexpr size_t SIZE = 1024;
+
+    std::array<Record, SIZE> records;
+    std::atomic<size_t>      head{0}; // next slot to write, owned by the producer
+    std::atomic<size_t>      tail{0}; // next slot to read, owned by the consumer
+    std::atomic<bool>        orphaned{false}; // the producer thread has exited
+
+public:
+    Record* claim() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == SIZE)
+            return nullptr;
+        return &records[h % SIZE];
+    }
+
+    void publish() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(Record& out) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        out = records[t % SIZE];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void orphan() {
+        orphaned.store(true, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+    }
+
+    bool isOrphaned() const {
+        return orphaned.load(std::memory_order_acquire);
+    }
+};
+
+static const char  levelNames[]              = { 'T', 'D', 'I', 'W', 'E' };
+static const char* categoryNames[CAT_COUNT] = { "cpu", "int", "bus", "timer" };
+
+// Rings are shared with the registry so records survive the thread that produced them; drain()
+// drops a ring once its thread has exited and everything it wrote has been printed
+static std::mutex                         registryMutex;
+static std::vector<std::shared_ptr<Ring>> rings;
+static std::atomic<uint64_t>              droppedRecords{0};
+
+static std::thread             drainThread;
+static std::mutex              drainMutex;
+static std::condition_variable drainCv;
+static bool                    stopDrain = false;
+static FILE*                   output = stdout;
+
+// Registers the calling thread's ring on first use and marks it orphaned when the thread exits
+struct RingOwner {
+    std::shared_ptr<Ring> ring = std::make_shared<Ring>();
+
+    RingOwner() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        rings.push_back(ring);
+    }
+
+    ~RingOwner() {
+        ring->orphan();
+    }
+};
+
+static Ring& localRing() {
+    thread_local RingOwner owner;
+    return *owner.ring;
+}
+
+void write(Level level, Category category, const char* fmt, ...) {
+    Ring& ring = localRing();
+    Record* r = ring.claim();
+    if (!r) {
+        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    r->level = level;
+    r->category = category;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(r->msg, sizeof(r->msg), fmt, args);
+    va_end(args);
+
+    ring.publish();
+}
+
+static void drain() {
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        snapshot = rings;
+    }
+
+    Record r;
+    bool retired = false;
+    for (auto& ring : snapshot) {
+        while (ring->pop(r)) {
+            fprintf(output, "%c %-5s %s\n", levelNames[r.level], categoryNames[r.category], r.msg);
+        }
+        retired |= ring->isOrphaned();
+    }
+    fflush(output);
+
+    if (retired) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::erase_if(rings, [](const std::shared_ptr<Ring>& ring) { return ring->isOrphaned() && ring->empty(); });
+    }
+}
+
+void start(FILE* out) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    if (drainThread.joinable())
+        return;
+
+    output = out;
+    stopDrain = false;
+    drainThread = std::thread([] {
+        std::unique_lock<std::mutex> lock(drainMutex);
+        while (!stopDrain) {
+            drainCv.wait_for(lock, std::chrono::milliseconds(10), [] { return stopDrain; });
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    });
+}
+
+void stop() {
+    {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        stopDrain = true;
+    }
+    drainCv.notify_one();
+    if (drainThread.joinable())
+        drainThread.join();
+    drain();
+
+    if (uint64_t n = dropped())
+        fprintf(output, "W log   %llu records dropped\n", (unsigned long long)n);
+}
+
+uint64_t dropped() {
+    return droppedRecords.load(std::memory_order_relaxed);
+}
+
+}
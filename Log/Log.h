@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace Log {
+
+enum Level {
+    LEVEL_TRACE,
+    LEVEL_DEBUG,
+    LEVEL_INFO,
+    LEVEL_WARN,
+    LEVEL_ERROR,
+    LEVEL_OFF,
+};
+
+enum Category {
+    CAT_CPU,
+    CAT_INT,
+    CAT_BUS,
+    CAT_TIMER,
+    CAT_COUNT,
+};
+
+// Records below this level are discarded at compile time; override with -DGB_LOG_LEVEL=<n>
+#ifndef GB_LOG_LEVEL
+#define GB_LOG_LEVEL 2
+#endif
+constexpr int threshold = GB_LOG_LEVEL;
+
+// Formats a record into the calling thread's ring buffer. Never blocks and never touches the
+// console; if the drain thread falls behind, records are dropped and counted instead.
+void write(Level level, Category category, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+void     start(FILE* out = stdout); // start the background drain thread
+void     stop();                    // drain whatever is left and join it
+uint64_t dropped();
+
+}
+
+#define GB_LOG(level, category, ...)                          \
+    do {                                                      \
+        if constexpr ((level) >= Log::threshold)              \
+            Log::write((level), (category), __VA_ARGS__);     \
+    } while (0)
@@ -0,0 +1,372 @@
+#include "Machine.h"
+#include "../StateHash/StateHash.h"
+
+#include <algorithm>
+#include <climits>
+
+template<class Config>
+BasicMachine<Config>::BasicMachine(const std::string& savePath)
+    : RAMBankSwitchable0(0xa000, 0x2000, savePath)
+    , timer(sched, [this] { irq.request(INT_TIMER); })
+    , dma(sched, [this](uint16_t source) { oamTransfer(source); }, [this](bool locked) { bus.dmaLock = locked; })
+    , pad([this] { irq.request(INT_JOYPAD); })
+    , sio(sched, timer, [this] { irq.request(INT_SERIAL); })
+    , core(bus, irq)
+{
+    mapDevices();
+    bus.mapMemory(0x8000, 0x9fff, MEM_TYPE_VRAM);
+    bus.mapMemory(0xc000, 0xdfff, MEM_TYPE_RAM);
+    bus.mapMemory(0xfe00, 0xfeff, MEM_TYPE_REG); /* OAM */
+    bus.mirrorRange(0xe000, 0xfdff, 0xc000); /* Echo RAM */
+}
+
+template<class Config>
+BasicMachine<Config>::BasicMachine(BasicMachine& parent)
+    : RAMBankSwitchable0(0xa000, 0x2000)
+    , timer(sched, [this] { irq.request(INT_TIMER); })
+    , dma(sched, [this](uint16_t source) { oamTransfer(source); }, [this](bool locked) { bus.dmaLock = locked; })
+    , pad([this] { irq.request(INT_JOYPAD); })
+    , sio(sched, timer, [this] { irq.request(INT_SERIAL); })
+    , core(bus, irq)
+{
+    mapDevices();
+    copyStateFrom(parent);
+}
+
+template<class Config>
+void BasicMachine<Config>::mapDevices() {
+    bus.mapRange(0, 0x3fff, &ROMBank0);
+    bus.mapRange(0x4000, 0x7fff, &ROMBankSwitchable0);
+    bus.mapRange(0xa000, 0xbfff, &RAMBankSwitchable0);
+    bus.mapRange(0xff00, 0xffff, &RegisterMem); /* Mostly registers */
+    bus.mapRange(0xff00, 0xff00, &pad);
+    bus.mapRange(0xff01, 0xff02, &sio);
+    bus.mapRange(0xff04, 0xff07, &timer);
+    bus.mapRange(0xff46, 0xff46, &dma);
+    bus.mapRange(0xff0f, 0xff0f, &irq);
+    bus.mapRange(0xffff, 0xffff, &irq);
+
+    irq.setWakeHook([this] { woken = true; });
+    timer.onDividerReset = [this](uint16_t divider) { sio.dividerReset(divider); };
+}
+
+// One page-pointer memcpy when source and OAM are plain memory (or ROM); byte by byte through
+// the bus otherwise, e.g. from cartridge RAM or with watchpoints
+template<class Config>
+void BasicMachine<Config>::oamTransfer(uint16_t source) {
+    if (bus.copyBlock(0xfe00, source, OAMDMA::LENGTH))
+        return;
+    for (uint16_t i = 0; i < OAMDMA::LENGTH; ++i)
+        bus.write(0xfe00 + i, bus.read(source + i));
+}
+
+template<class Config>
+uint8_t BasicMachine<Config>::read(uint16_t addr) {
+    return bus.read(addr);
+}
+
+template<class Config>
+uint8_t BasicMachine<Config>::peek(uint16_t addr) {
+    return bus.peek(addr);
+}
+
+template<class Config>
+void BasicMachine<Config>::write(uint16_t addr, uint8_t val) {
+    bus.write(addr, val);
+}
+
+template<class Config>
+void BasicMachine<Config>::poke(uint16_t addr, uint8_t val) {
+    bus.poke(addr, val);
+}
+
+template<class Config>
+void BasicMachine<Config>::loadROM(std::shared_ptr<const ROMImage> rom) {
+    ROMBank0.attach(rom, 0);
+    ROMBankSwitchable0.attach(rom, 1);
+}
+
+template<class Config>
+void BasicMachine<Config>::setRegisterStateJSON(json& state) {
+    core.setRegisterStateJSON(state);
+}
+
+template<class Config>
+CPU::Registers BasicMachine<Config>::registers() {
+    return core.getRegisters();
+}
+
+template<class Config>
+void BasicMachine<Config>::reset(Model model, bool postBoot) {
+    sched.reset();
+    bus.clearMemory();
+    ROMBank0.reset();
+    ROMBankSwitchable0.reset();
+    RegisterMem.reset();
+    irq.reset();
+    timer.reset();
+    dma.reset();
+    pad.reset();
+    sio.reset();
+    woken = false;
+
+    if (!postBoot) {
+        core.reset(CPU::Registers{});
+        bus.stats->reset();
+        return;
+    }
+
+    for (const BootState::IORegister& r : BootState::io) {
+        if (r.addr == 0xff46)
+            dma.reset(r.value[model]); // the boot ROM leaves a value there but never ran a transfer
+        else
+            bus.write(r.addr, r.value[model]);
+    }
+    timer.setDivider(BootState::divider[model]);
+
+    CPU::Registers regs = BootState::cpu[model];
+    if ((model == MODEL_DMG || model == MODEL_MGB) && bus.read(0x014d) == 0)
+        regs.f &= ~BootState::checksumFlags;
+    core.reset(regs);
+
+    // the register writes above are not guest activity
+    bus.stats->reset();
+    if constexpr (BusT::DebugPolicy::enabled)
+        bus.debug.hit = false;
+}
+
+template<class Config>
+void BasicMachine<Config>::setTrace(std::ofstream* output, TraceIndexer* index) {
+    if constexpr (Config::tracing) {
+        // gameboy-doctor logs start with the state before the first instruction
+        trace = output;
+        traceIndex = index;
+        if (trace) {
+            traceOffset = trace->tellp();
+            appendTrace();
+        }
+    } else if (output) {
+        throw std::invalid_argument("Machine was built without tracing");
+    }
+}
+
+template<class Config>
+void BasicMachine<Config>::appendTrace() requires Config::tracing {
+    if (traceIndex)
+        traceIndex->add(traceOffset, core.getPC());
+    traceOffset += core.streamAppendState(*trace);
+}
+
+template<class Config>
+void BasicMachine<Config>::attachProfiler(Profiler* profiler) {
+    if (!Config::profiling && profiler)
+        throw std::invalid_argument("Machine was built without profiling");
+    core.profiler = profiler;
+}
+
+template<class Config>
+void BasicMachine<Config>::attachFlightRecorder(FlightRecorder* recorder) {
+    if (!Config::recording && recorder)
+        throw std::invalid_argument("Machine was built without the flight recorder");
+    core.recorder = recorder;
+
+    if (recorder) {
+        recorder->setPeek([this](uint16_t addr) { return bus.peek(addr); });
+        sio.onSerial = [recorder](uint8_t byte) { recorder->serialByte(byte); };
+    } else {
+        sio.onSerial = nullptr;
+    }
+}
+
+template<class Config>
+uint64_t BasicMachine<Config>::run(uint64_t until) {
+    while (sched.now < until) {
+        if (core.halt && !irq.pending) {
+            // Only a device event can end HALT, so skip straight from one event to the next
+            // until the wake hook reports that one of them raised an interrupt
+            const uint64_t haltStart = sched.now;
+            woken = false;
+            while (!woken && sched.nextEvent() < until)
+                sched.advance(sched.nextEvent());
+            if (!woken)
+                sched.advance(until);
+
+            bus.stats->haltedCycles.inc((sched.now - haltStart) / 4);
+            bus.stats->mcycles.inc((sched.now - haltStart) / 4);
+            continue;
+        }
+
+        if ((sched.now & 0b11) == 0) {
+            // Between device events only the core changes state, so it runs ahead instruction
+            // after instruction until one is due. Whatever it writes can at most move the next
+            // event, which is read again before every instruction.
+            for (;;) {
+                const uint64_t horizon = std::min(sched.nextEvent(), until);
+                if constexpr (Config::fusion) {
+                    // A superinstruction may not run past the next device event or the end of this slice
+                    core.fuseBudget = int(std::min<uint64_t>((horizon - sched.now - 1) >> 2, INT_MAX));
+                }
+                if (core.insCycle()) {
+                    if constexpr (Config::tracing) {
+                        if (trace) appendTrace();
+                    }
+                }
+
+                if constexpr (BusT::DebugPolicy::enabled) {
+                    if (bus.debug.hit) {
+                        sched.advance(sched.now + 1);
+                        return sched.now;
+                    }
+                }
+
+                const uint64_t next = sched.now + 4 * uint64_t(core.wait);
+                if (core.wait <= 0 || core.halt || next >= horizon)
+                    break;
+                sched.advance(next);
+                core.wait = 1;
+            }
+
+            // Until its next fetch the core only counts wait down, so jump straight to that
+            // m-cycle (or the end of the slice), stopping at every device event on the way
+            if (core.wait > 0) {
+                const uint64_t idle = std::min<uint64_t>(core.wait - 1, (until - 1 - sched.now) >> 2);
+                const uint64_t resume = std::min(sched.now + 4 * (idle + 1), until);
+                core.wait -= int(idle);
+                while (sched.nextEvent() < resume)
+                    sched.advance(sched.nextEvent());
+                sched.advance(resume);
+                continue;
+            }
+        }
+        sched.advance(sched.now + 1);
+    }
+    return sched.now;
+}
+
+template<class Config>
+std::unique_ptr<Machine> BasicMachine<Config>::clone() {
+    return std::make_unique<BasicMachine>(*this);
+}
+
+template<class Config>
+void BasicMachine<Config>::copyStateFrom(Machine& other) {
+    BasicMachine* parent = dynamic_cast<BasicMachine*>(&other);
+    if (!parent)
+        throw std::invalid_argument("Machines were built with different options");
+    if (parent == this)
+        return;
+
+    bus.shareMemory(parent->bus);
+    sched.copyStateFrom(parent->sched);
+    ROMBank0.copyStateFrom(parent->ROMBank0);
+    ROMBankSwitchable0.copyStateFrom(parent->ROMBankSwitchable0);
+    RAMBankSwitchable0.copyStateFrom(parent->RAMBankSwitchable0);
+    RegisterMem.copyStateFrom(parent->RegisterMem);
+    irq.copyStateFrom(parent->irq);
+    timer.copyStateFrom(parent->timer);
+    dma.copyStateFrom(parent->dma);
+    pad.copyStateFrom(parent->pad);
+    sio.copyStateFrom(parent->sio);
+    core.copyStateFrom(parent->core);
+}
+
+template<class Config>
+void BasicMachine<Config>::captureDelta(MemoryDelta& out) {
+    auto append = [&out](uint16_t addr, const uint8_t* page) {
+        out.addrs.push_back(addr);
+        out.data.insert(out.data.end(), page, page + 0x100);
+    };
+    bus.takeDirtyPages([&append](int page, const uint8_t* data) { append(page << 8, data); });
+    RAMBankSwitchable0.takeWrittenPages(append);
+}
+
+template<class Config>
+void BasicMachine<Config>::applyDelta(const MemoryDelta& delta) {
+    for (size_t i = 0; i < delta.addrs.size(); i++) {
+        const uint16_t addr = delta.addrs[i];
+        const uint8_t* page = delta.data.data() + i * 0x100;
+        if (addr >= 0xa000 && addr < 0xc000)
+            RAMBankSwitchable0.loadPage(addr, page);
+        else
+            bus.loadPage(addr >> 8, page);
+    }
+}
+
+template<class Config>
+uint64_t BasicMachine<Config>::stateHash() {
+    uint8_t io[0x100];
+    for (int i = 0; i < 0x100; i++)
+        io[i] = bus.peek(0xff00 + i);
+
+    uint64_t h = StateHash::mix(bus.memoryHash(), RAMBankSwitchable0.contentHash());
+    h = StateHash::mix(h, StateHash::bytes(io, sizeof(io)));
+    h = StateHash::mix(h, core.stateHash());
+    // Device state that no register shows: pending deadlines, the low divider bits, a DMA or
+    // transfer in flight and the buttons held
+    h = StateHash::mix(h, sched.stateHash());
+    h = StateHash::mix(h, timer.stateHash());
+    h = StateHash::mix(h, dma.stateHash());
+    h = StateHash::mix(h, sio.stateHash());
+    h = StateHash::mix(h, pad.stateHash());
+    return StateHash::mix(h, sched.now);
+}
+
+template<class Config>
+Scheduler& BasicMachine<Config>::scheduler() {
+    return sched;
+}
+
+template<class Config>
+Joypad& BasicMachine<Config>::joypad() {
+    return pad;
+}
+
+template<class Config>
+Serial& BasicMachine<Config>::serial() {
+    return sio;
+}
+
+template<class Config>
+Stats::Counters& BasicMachine<Config>::stats() {
+    return *bus.stats;
+}
+
+template<class Config>
+Watchpoints* BasicMachine<Config>::watchpoints() {
+    if constexpr (BusT::DebugPolicy::enabled)
+        return &bus.debug;
+    return nullptr;
+}
+
+void MemoryDelta::clear() {
+    addrs.clear();
+    data.clear();
+}
+
+size_t MemoryDelta::bytes() const {
+    return data.size() + addrs.size() * sizeof(uint16_t);
+}
+
+#define INSTANTIATE(C) template class BasicMachine<C>;
+GB_FOR_EACH_CONFIG(INSTANTIATE)
+#undef INSTANTIATE
+
+// Pick the leanest config that has every requested feature
+template<class Config>
+static std::unique_ptr<Machine> make(const std::string& savePath) {
+    return std::make_unique<BasicMachine<Config>>(savePath);
+}
+
+std::unique_ptr<Machine> makeMachine(const MachineOptions& options) {
+    if (options.debug)
+        return make<CPU::DebugConfig>(options.savePath);
+
+    // Indexed by trace | profile << 1 | record << 2
+    static std::unique_ptr<Machine> (*const factories[8])(const std::string&) = {
+        make<CPU::ProductionConfig>,    make<CPU::TraceConfig>,
+        make<CPU::ProfileConfig>,       make<CPU::TraceProfileConfig>,
+        make<CPU::RecordConfig>,        make<CPU::TraceRecordConfig>,
+        make<CPU::ProfileRecordConfig>, make<CPU::TraceProfileRecordConfig>,
+    };
+    return factories[options.trace | options.profile << 1 | options.record << 2](options.savePath);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <vector>
+
+#include "../memory/memory.h"
+#include "../memory/saveram.h"
+#include "../memory/romimage.h"
+#include "../memory/watchpoints.h"
+#include "../Scheduler/Scheduler.h"
+#include "../Timer/Timer.h"
+#include "../OAMDMA/OAMDMA.h"
+#include "../Joypad/Joypad.h"
+#include "../Serial/Serial.h"
+#include "../InterruptController/InterruptController.h"
+#include "../LR35902/LR35902.h"
+#include "../LR35902/Config.h"
+#include "../Profiler/Profiler.h"
+#include "../BootState/BootState.h"
+#include "../TraceIndex/TraceIndex.h"
+#include "../FlightRecorder/FlightRecorder.h"
+#include "../Stats/Stats.h"
+
+// Memory pages taken by Machine::captureDelta(): page i holds the 256 bytes at addrs[i] and is
+// stored at data[i * 256]
+struct MemoryDelta {
+    std::vector<uint16_t> addrs;
+    std::vector<uint8_t>  data;
+
+    void   clear();
+    size_t bytes() const;
+};
+
+// One emulated Game Boy: the memory map, its devices, the CPU and the clock that drives them.
+// The concrete type (one per CPU::Config) decides what instrumentation is compiled in, so pick
+// it once at startup through makeMachine() and drive it through this interface.
+class Machine {
+public:
+    static constexpr uint64_t FRAME_CYCLES = 70224; // T-cycles per video frame
+
+    virtual ~Machine() = default;
+
+    virtual uint8_t  read(uint16_t addr) = 0;
+    virtual uint8_t  peek(uint16_t addr) = 0; // for the host, without stats or watchpoints
+    virtual void     write(uint16_t addr, uint8_t val) = 0;
+    virtual void     poke(uint16_t addr, uint8_t val) = 0; // test setup, reaches ROM (see BasicBus::poke)
+    virtual void     loadROM(std::shared_ptr<const ROMImage> rom) = 0; // shared, never copied
+    virtual void     setRegisterStateJSON(json& state) = 0;
+    virtual CPU::Registers registers() = 0;
+    // Bring the machine back to power-on (PC 0, for running a boot ROM) or post-boot state in
+    // place. Devices, mappings and the loaded ROM are kept; RAM, registers, the clock, the
+    // stats and bytes poked into ROM are cleared. Battery-backed cartridge RAM survives like it would on hardware.
+    // Post-boot applies the model's BootState tables, so call it after the ROM is loaded.
+    virtual void     reset(Model model, bool postBoot = true) = 0;
+    virtual void     setTrace(std::ofstream* output, TraceIndexer* index = nullptr) = 0;
+    virtual void     attachProfiler(Profiler* profiler) = 0;
+    virtual void     attachFlightRecorder(FlightRecorder* recorder) = 0;
+    virtual uint64_t run(uint64_t until) = 0; // stops early only when a watchpoint fires
+    // A new machine in the same state, sharing WRAM/VRAM pages with this one copy-on-write.
+    // The clone has no trace, profiler or recorder attached and its cartridge RAM is not
+    // backed by the save file.
+    virtual std::unique_ptr<Machine> clone() = 0;
+    // Put this machine in other's state in place, the save/restore path for run-ahead and
+    // rewinding. Memory is shared copy-on-write as in clone(), so the copy costs a page table up
+    // front and a page copy per page either side writes afterwards. Both machines must come
+    // from the same makeMachine() options. Attached trace, profiler, recorder, stats and the
+    // save file stay with this machine.
+    virtual void copyStateFrom(Machine& other) = 0;
+    // Incremental snapshots of memory. captureDelta() appends the pages of WRAM, VRAM, OAM and
+    // cartridge RAM written since the previous capture (all of them on the first, and after
+    // reset() or copyStateFrom()), so its cost follows how much the guest wrote rather than how
+    // much memory there is. applyDelta() writes captured pages back; a full capture followed by
+    // the deltas after it rebuilds memory. CPU, device and IO register state is a few hundred
+    // bytes and goes whole, through copyStateFrom().
+    virtual void captureDelta(MemoryDelta& out) = 0;
+    virtual void applyDelta(const MemoryDelta& delta) = 0;
+    // Hash of everything the guest can observe: memory, cartridge RAM, the IO registers and HRAM
+    // as read, CPU state and the clock. Only pages written since the previous call are rehashed,
+    // so it is cheap enough for every frame; equal states hash equal across builds and configs.
+    virtual uint64_t stateHash() = 0;
+
+    virtual Scheduler&       scheduler() = 0;
+    virtual Joypad&          joypad() = 0;
+    virtual Serial&          serial() = 0;
+    virtual Stats::Counters& stats() = 0;
+    virtual Watchpoints*     watchpoints() = 0; // nullptr unless built on the debug bus
+};
+
+template<class Config>
+class BasicMachine : public Machine {
+private:
+    using BusT = typename Config::BusType;
+
+    BusT                bus;
+    Scheduler           sched;
+    ROMBlock            ROMBank0{0x0000, 0x4000};
+    ROMBlock            ROMBankSwitchable0{0x4000, 0x4000};
+    SaveRAMBlock        RAMBankSwitchable0;
+    REGBlock            RegisterMem{0xfe00, 0x01ff};
+    InterruptController irq;
+    Timer               timer;
+    OAMDMA              dma;
+    Joypad              pad;
+    Serial              sio;
+    CPU::BasicLR35902<Config> core;
+
+    std::ofstream* trace = nullptr;
+    TraceIndexer*  traceIndex = nullptr;
+    uint64_t       traceOffset = 0; // bytes written to trace so far
+    bool           woken = false;
+
+    void mapDevices();
+    void oamTransfer(uint16_t source);
+    void appendTrace() requires Config::tracing;
+
+public:
+    BasicMachine(const std::string& savePath);
+    BasicMachine(BasicMachine& parent); // see clone()
+
+    uint8_t  read(uint16_t addr) override;
+    uint8_t  peek(uint16_t addr) override;
+    void     write(uint16_t addr, uint8_t val) override;
+    void     poke(uint16_t addr, uint8_t val) override;
+    void     loadROM(std::shared_ptr<const ROMImage> rom) override;
+    void     setRegisterStateJSON(json& state) override;
+    CPU::Registers registers() override;
+    void     reset(Model model, bool postBoot = true) override;
+    void     setTrace(std::ofstream* output, TraceIndexer* index = nullptr) override;
+    void     attachProfiler(Profiler* profiler) override;
+    void     attachFlightRecorder(FlightRecorder* recorder) override;
+    uint64_t run(uint64_t until) override;
+    std::unique_ptr<Machine> clone() override;
+    void     copyStateFrom(Machine& other) override;
+    void     captureDelta(MemoryDelta& out) override;
+    void     applyDelta(const MemoryDelta& delta) override;
+    uint64_t stateHash() override;
+
+    Scheduler&       scheduler() override;
+    Joypad&          joypad() override;
+    Serial&          serial() override;
+    Stats::Counters& stats() override;
+    Watchpoints*     watchpoints() override;
+};
+
+// features requested at startup, makeMachine() maps them onto a Config
+struct MachineOptions {
+    bool        debug   = false; // watchpoints (implies every other feature and the slower debug bus)
+    bool        trace   = false;
+    bool        profile = false;
+    bool        record  = false; // flight recorder ring with dump triggers
+    std::string savePath;        // battery save backing cartridge RAM, empty for none
+};
+
+std::unique_ptr<Machine> makeMachine(const MachineOptions& options);
@@ -0,0 +1,109 @@
+#include "Movie.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+
+namespace {
+
+const char     movieMagic[4] = {'G', 'B', 'M', 'V'};
+const uint32_t movieVersion  = 2;
+const uint16_t saveRAMStart  = 0xa000;
+const uint16_t saveRAMSize   = 0x2000;
+
+struct MovieHeader {
+    char     magic[4];
+    uint32_t version;
+    uint8_t  model;
+    uint8_t  reserved;
+    uint16_t romChecksum;
+    uint32_t frames;
+    uint32_t saveRAMBytes;
+};
+
+uint16_t romChecksumOf(Machine& machine) {
+    return machine.peek(0x014e) << 8 | machine.peek(0x014f);
+}
+
+}
+
+Movie::Movie(Machine& machine, Model model) : model(model), romChecksum(romChecksumOf(machine)) {
+    saveRAM.resize(saveRAMSize);
+    for (uint16_t i = 0; i < saveRAMSize; i++)
+        saveRAM[i] = machine.peek(saveRAMStart + i);
+}
+
+void Movie::record(uint8_t buttons) {
+    frames.push_back(buttons);
+}
+
+void Movie::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("Failed to open movie: " + path);
+
+    MovieHeader header{};
+    std::copy(movieMagic, movieMagic + 4, header.magic);
+    header.version      = movieVersion;
+    header.model        = uint8_t(model);
+    header.romChecksum  = romChecksum;
+    header.frames       = uint32_t(frames.size());
+    header.saveRAMBytes = uint32_t(saveRAM.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(saveRAM.data()), saveRAM.size());
+    out.write(reinterpret_cast<const char*>(frames.data()), frames.size());
+    if (!out)
+        throw std::runtime_error("Failed to write movie: " + path);
+}
+
+Movie Movie::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Failed to open movie: " + path);
+
+    MovieHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || !std::equal(movieMagic, movieMagic + 4, header.magic) || header.version != movieVersion
+        || header.model >= MODEL_COUNT || header.saveRAMBytes > saveRAMSize)
+        throw std::runtime_error("Not a movie: " + path);
+
+    Movie movie;
+    movie.model       = Model(header.model);
+    movie.romChecksum = header.romChecksum;
+    movie.saveRAM.resize(header.saveRAMBytes);
+    movie.frames.resize(header.frames);
+    if (!in.read(reinterpret_cast<char*>(movie.saveRAM.data()), header.saveRAMBytes)
+        || !in.read(reinterpret_cast<char*>(movie.frames.data()), header.frames))
+        throw std::runtime_error("Truncated movie: " + path);
+    return movie;
+}
+
+void Movie::begin(Machine& machine) const {
+    const uint16_t loaded = romChecksumOf(machine);
+    if (loaded != romChecksum)
+        throw std::invalid_argument(std::format("Movie was recorded on ROM {:04x}, machine has {:04x}", romChecksum, loaded));
+    machine.reset(model);
+    for (size_t i = 0; i < saveRAM.size(); i++)
+        machine.poke(saveRAMStart + i, saveRAM[i]);
+}
+
+uint64_t Movie::play(Machine& machine, size_t first, size_t count) const {
+    const size_t last = first + std::min(count, frames.size() - std::min(first, frames.size()));
+    for (size_t i = first; i < last; i++)
+        runFrame(machine, frames[i]);
+    return machine.scheduler().now;
+}
+
+uint64_t runFrame(Machine& machine, uint8_t buttons) {
+    machine.joypad().setButtons(buttons);
+
+    // Watchpoints only pause a debug machine, a frame always runs to its end
+    const uint64_t until = (machine.scheduler().now / Machine::FRAME_CYCLES + 1) * Machine::FRAME_CYCLES;
+    while (machine.run(until) < until) {
+        if (Watchpoints* wp = machine.watchpoints())
+            wp->hit = false;
+    }
+    return until;
+}
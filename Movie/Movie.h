@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../Machine/Machine.h"
+
+// Input movie: the Joypad mask held during each frame of a run that starts from a post-boot reset.
+// Buttons only change on frame boundaries (every Machine::FRAME_CYCLES from the reset) and the
+// machine is deterministic otherwise, so playing a movie back on the same ROM and model repeats
+// the run exactly. That makes it a fixed workload for benchmarks and for bisecting between builds.
+// Cartridge RAM survives reset() and the run itself writes it, so the movie also carries its
+// contents at the start and begin() puts them back. On a machine with a save file that would
+// overwrite the save, so replays run on a machine built without one.
+// On disk it is a small "GBMV" header, the starting cartridge RAM, then one byte per frame.
+class Movie {
+public:
+    Model                model = MODEL_DMG;
+    uint16_t             romChecksum = 0; // cartridge header global checksum, catches the wrong ROM
+    std::vector<uint8_t> frames;          // JoypadButton mask per frame
+    std::vector<uint8_t> saveRAM;         // cartridge RAM (0xa000 on) when the movie starts
+
+    Movie() = default;
+    Movie(Machine& machine, Model model); // empty movie for the ROM and cartridge RAM in machine
+
+    void record(uint8_t buttons); // append a frame
+    void save(const std::string& path) const;
+    static Movie load(const std::string& path);
+
+    // Reset machine to the start of the movie and restore its cartridge RAM, after checking it
+    // has the movie's ROM loaded
+    void     begin(Machine& machine) const;
+    // Run frames [first, first + count) of the movie, clamped to its length; returns the clock
+    uint64_t play(Machine& machine, size_t first = 0, size_t count = SIZE_MAX) const;
+};
+
+// Hold buttons for the rest of the current frame and run to its end
+uint64_t runFrame(Machine& machine, uint8_t buttons);
@@ -0,0 +1,66 @@
+#include "OAMDMA.h"
+#include "../Log/Log.h"
+#include "../StateHash/StateHash.h"
+
+OAMDMA::OAMDMA(Scheduler& sched, std::function<void(uint16_t)> copy, std::function<void(bool)> lockBus)
+    : sched(sched), copy(std::move(copy)), lockBus(std::move(lockBus)), memtype(MEM_TYPE_REG) {
+    sched.setHandler(EVENT_OAM_DMA, [this] { finish(); });
+}
+
+void OAMDMA::reset(uint8_t value) {
+    reg = value;
+    if (active)
+        lockBus(false);
+    active = false;
+    sched.cancel(EVENT_OAM_DMA);
+}
+
+void OAMDMA::copyStateFrom(const OAMDMA& other) {
+    reg = other.reg;
+    if (active != other.active)
+        lockBus(other.active);
+    active = other.active;
+}
+
+uint64_t OAMDMA::stateHash() const {
+    return StateHash::mix(reg, active);
+}
+
+bool OAMDMA::busy() const {
+    return active;
+}
+
+void OAMDMA::finish() {
+    GB_LOG(Log::LEVEL_TRACE, Log::CAT_BUS, "OAM DMA from %02x00 done", reg);
+    active = false;
+    lockBus(false);
+}
+
+uint8_t OAMDMA::read(uint16_t) {
+    return reg;
+}
+
+bool OAMDMA::write(uint16_t, uint8_t val) {
+    reg = val;
+
+    // Sources past 0xdf00 would overlap OAM and IO; the DMA sees echo RAM there instead
+    const uint16_t source = (val >= 0xe0 ? val - 0x20 : val) << 8;
+    copy(source);
+
+    // A write while a transfer runs restarts it
+    if (!active)
+        lockBus(true);
+    active = true;
+    sched.schedule(EVENT_OAM_DMA, sched.now + DURATION);
+    return true;
+}
+
+int OAMDMA::getMemtype() {
+    return memtype;
+}
+
+int OAMDMA::relativeUpdate(uint16_t addr, uint8_t val) {
+    uint8_t res = reg + val;
+    write(addr, res);
+    return res;
+}
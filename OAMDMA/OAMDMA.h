@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "../memory/memory.h"
+#include "../Scheduler/Scheduler.h"
+
+// OAM DMA (0xff46).
+// Writing the register copies 160 bytes from (value << 8) to OAM (0xfe00 - 0xfe9f) and hands the
+// external bus to the DMA for 160 M-cycles, during which the CPU only reaches 0xff00 - 0xffff.
+// Since nothing else can see OAM or the source in that window, the bytes are moved in one bulk
+// copy when the transfer starts and the only thing scheduled is its end.
+class OAMDMA : public MemoryDevice {
+private:
+    Scheduler& sched;
+    std::function<void(uint16_t)> copy;    // 160 bytes from source to OAM
+    std::function<void(bool)>     lockBus; // take the external bus away from the CPU, or give it back
+
+    uint8_t   reg = 0;
+    bool      active = false;
+    const int memtype;
+
+    void finish();
+
+public:
+    static constexpr uint16_t LENGTH   = 0xa0;
+    static constexpr uint64_t DURATION = LENGTH * 4; // T-cycles
+
+    OAMDMA(Scheduler& sched, std::function<void(uint16_t)> copy, std::function<void(bool)> lockBus);
+
+    void    reset(uint8_t value = 0); // load the register without starting a transfer
+    void    copyStateFrom(const OAMDMA& other); // the scheduler's copy carries the pending end
+    uint64_t stateHash() const; // of what copyStateFrom copies
+    bool    busy() const;
+
+    uint8_t read(uint16_t addr) override;
+    bool    write(uint16_t addr, uint8_t val) override;
+    int     getMemtype() override;
+    int     relativeUpdate(uint16_t addr, uint8_t val) override;
+};
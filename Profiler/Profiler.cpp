@@ -0,0 +1,137 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+Profiler::Profiler() {
+    nodes.push_back({ ROOT, ROOT });
+}
+
+// There is no MBC yet, so 0x4000 - 0x7fff always holds ROM bank 1 and everything else is bank 0
+uint32_t Profiler::key(uint16_t addr) {
+    uint32_t bank = (addr >= 0x4000 && addr < 0x8000) ? 1 : 0;
+    return (bank << 16) | addr;
+}
+
+void Profiler::loadSymbols(const std::string& path) {
+    std::ifstream f{path};
+    if (!f.is_open()) {
+        throw std::runtime_error("Failed to open symbol file: " + path);
+    }
+
+    // RGBDS format: "BB:AAAA Name", ';' starts a comment
+    std::string line;
+    while (std::getline(f, line)) {
+        line = line.substr(0, line.find(';'));
+
+        unsigned bank, addr;
+        char name[256];
+        if (sscanf(line.c_str(), "%x:%x %255s", &bank, &addr, name) == 3)
+            symbols[(bank << 16) | (addr & 0xffff)] = name;
+    }
+}
+
+uint32_t Profiler::enter(uint32_t func) {
+    auto [it, inserted] = children.try_emplace({ current, func }, uint32_t(nodes.size()));
+    if (inserted)
+        nodes.push_back({ current, func });
+    return current = it->second;
+}
+
+void Profiler::leave() {
+    // Returning from the bottom frame (stack tricks, or a RET we never saw the CALL for) stays put
+    if (current != 0)
+        current = nodes[current].parent;
+}
+
+void Profiler::instruction(uint16_t pc, uint8_t opcode, uint16_t nextPC, int cycles) {
+    Site& site = sites[key(pc)];
+    site.count++;
+    site.cycles += cycles;
+    nodes[current].cycles += cycles;
+
+    switch (opcode) {
+        case 0xc4: case 0xcc: case 0xd4: case 0xdc: /* CALL cc */
+            if (nextPC == uint16_t(pc + 3))
+                break;
+            [[fallthrough]];
+        case 0xcd:                                   /* CALL */
+        case 0xc7: case 0xcf: case 0xd7: case 0xdf:  /* RST */
+        case 0xe7: case 0xef: case 0xf7: case 0xff:
+            enter(key(nextPC));
+            break;
+
+        case 0xc0: case 0xc8: case 0xd0: case 0xd8:  /* RET cc */
+            if (nextPC == uint16_t(pc + 1))
+                break;
+            [[fallthrough]];
+        case 0xc9: case 0xd9:                        /* RET, RETI */
+            leave();
+            break;
+    }
+}
+
+void Profiler::interrupt(uint16_t vector, int cycles) {
+    enter(key(vector));
+    nodes[current].cycles += cycles;
+}
+
+std::string Profiler::name(uint32_t func, bool withOffset) const {
+    if (func == ROOT)
+        return "[root]";
+
+    auto it = symbols.upper_bound(func);
+    if (it != symbols.begin()) {
+        --it;
+        if ((it->first >> 16) == (func >> 16)) {
+            uint32_t off = func - it->first;
+            if (off == 0 || !withOffset)
+                return it->second;
+            return std::format("{}+0x{:x}", it->second, off);
+        }
+    }
+    return std::format("{:02X}:{:04X}", func >> 16, func & 0xffff);
+}
+
+void Profiler::writeFolded(std::ostream& out) const {
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].cycles == 0)
+            continue;
+
+        std::vector<std::string> frames;
+        for (uint32_t n = i; n != ROOT; n = nodes[n].parent) {
+            frames.push_back(name(nodes[n].func, false));
+        }
+
+        std::string stack;
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+            if (!stack.empty()) stack += ';';
+            stack += *it;
+        }
+        out << stack << ' ' << nodes[i].cycles << '\n';
+    }
+}
+
+void Profiler::writeHotspots(std::ostream& out, size_t n) const {
+    std::vector<std::pair<uint32_t, Site>> sorted(sites.begin(), sites.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second.cycles > b.second.cycles;
+    });
+
+    uint64_t total = 0;
+    for (const auto& [addr, site] : sorted) {
+        total += site.cycles;
+    }
+
+    out << std::format("{:>7}  {:<32} {:>12} {:>12} {:>7}\n", "ADDR", "SYMBOL", "COUNT", "M-CYCLES", "%");
+    for (size_t i = 0; i < std::min(n, sorted.size()); i++) {
+        const auto& [addr, site] = sorted[i];
+        out << std::format("{:02X}:{:04X}  {:<32} {:>12} {:>12} {:>6.2f}%\n",
+            addr >> 16, addr & 0xffff, name(addr, true), site.count, site.cycles,
+            total ? 100.0 * site.cycles / total : 0.0);
+    }
+}
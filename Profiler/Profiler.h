@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <ostream>
+
+// Guest code profiler.
+// Counts retired instructions and M-cycles per bank:PC, follows CALL/RST/RET/RETI and interrupt
+// entry to keep a shadow call stack, and attributes cycles to the stack they were spent in.
+// Results are written as flamegraph.pl compatible folded stacks and a top-N hotspot table,
+// with addresses resolved through an RGBDS .sym file when one is loaded.
+class Profiler {
+private:
+    struct Site {
+        uint64_t count  = 0;
+        uint64_t cycles = 0;
+    };
+
+    struct Node {
+        uint32_t parent;
+        uint32_t func;       // bank << 16 | entry address, ROOT for the bottom frame
+        uint64_t cycles = 0; // self cycles
+    };
+
+    static constexpr uint32_t ROOT = UINT32_MAX;
+
+    std::map<uint32_t, std::string>                symbols; // bank << 16 | addr -> name
+    std::unordered_map<uint32_t, Site>             sites;
+    std::vector<Node>                              nodes;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> children; // (parent node, func) -> node
+    uint32_t current = 0;
+
+    static uint32_t key(uint16_t addr);
+    uint32_t    enter(uint32_t func);
+    void        leave();
+    std::string name(uint32_t func, bool withOffset) const;
+
+public:
+    Profiler();
+
+    void loadSymbols(const std::string& path);
+
+    void instruction(uint16_t pc, uint8_t opcode, uint16_t nextPC, int cycles);
+    void interrupt(uint16_t vector, int cycles);
+
+    void writeFolded(std::ostream& out) const;
+    void writeHotspots(std::ostream& out, size_t n = 20) const;
+};
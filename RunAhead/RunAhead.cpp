@@ -0,0 +1,53 @@
+#include "RunAhead.h"
+#include "../Movie/Movie.h"
+
+#include <chrono>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+uint64_t nanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+RunAhead::RunAhead(Machine& machine, int frames) : machine(machine), frames(frames) {
+    if (frames < 0)
+        throw std::invalid_argument("Run-ahead frame count must not be negative");
+    if (frames > 0)
+        spare = machine.clone();
+}
+
+Machine& RunAhead::frame(uint8_t buttons) {
+    const uint64_t start = nanos();
+    runFrame(machine, buttons);
+    const uint64_t real = nanos();
+    spent.frames++;
+    spent.realNs += real - start;
+    if (!spare)
+        return machine;
+
+    spare->copyStateFrom(machine);
+    const uint64_t saved = nanos();
+    for (int i = 0; i < frames; i++)
+        runFrame(*spare, buttons);
+    spent.saveNs  += saved - real;
+    spent.aheadNs += nanos() - saved;
+    return *spare;
+}
+
+const RunAhead::Timing& RunAhead::timing() const {
+    return spent;
+}
+
+void RunAhead::report(std::ostream& out) const {
+    const double n = spent.frames ? double(spent.frames) : 1.0;
+    const double total = (spent.realNs + spent.saveNs + spent.aheadNs) / n / 1e3;
+    out << std::format("run-ahead {} frames over {} frames: {:.1f} us/frame (real {:.1f}, save {:.1f}, ahead {:.1f})"
+                       ", {:.2f}x the cost of plain emulation\n",
+        frames, spent.frames, total, spent.realNs / n / 1e3, spent.saveNs / n / 1e3, spent.aheadNs / n / 1e3,
+        spent.realNs ? total * 1e3 * n / spent.realNs : 0.0);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "../Machine/Machine.h"
+
+// Run-ahead: hides the frames of input lag a game builds in by presenting the state it would
+// reach a few frames from now with the current input still held.
+// Every frame the real machine runs one frame, a spare machine takes over its state through
+// Machine::copyStateFrom, runs `frames` frames further and is what gets presented. That is the
+// usual save / run ahead / restore cycle with the restore reduced to nothing: the real machine
+// never runs speculative frames, so its trace, stats and save file only ever see real input.
+class RunAhead {
+public:
+    // Wall time spent per part of a frame, summed over frames
+    struct Timing {
+        uint64_t frames  = 0;
+        uint64_t realNs  = 0; // the real frame
+        uint64_t saveNs  = 0; // copying its state to the spare machine
+        uint64_t aheadNs = 0; // the speculative frames
+    };
+
+private:
+    Machine&                 machine;
+    std::unique_ptr<Machine> spare;
+    int                      frames;
+    Timing                   spent;
+
+public:
+    RunAhead(Machine& machine, int frames);
+
+    // Run one real frame with buttons held, then run ahead; returns the machine to present
+    Machine& frame(uint8_t buttons);
+
+    const Timing& timing() const;
+    void          report(std::ostream& out) const; // per-frame averages
+};
@@ -0,0 +1,66 @@
+#include "Scheduler.h"
+#include "../StateHash/StateHash.h"
+
+Scheduler::Scheduler() {
+    when.fill(NEVER);
+}
+
+void Scheduler::reset() {
+    when.fill(NEVER);
+    next = NEVER;
+    now = 0;
+}
+
+void Scheduler::copyStateFrom(const Scheduler& other) {
+    when = other.when;
+    next = other.next;
+    now  = other.now;
+}
+
+uint64_t Scheduler::stateHash() const {
+    uint64_t h = 0;
+    for (int i = 0; i < EVENT_STATS_DUMP; i++)
+        h = StateHash::mix(h, when[i] == NEVER ? NEVER : when[i] - now);
+    return h;
+}
+
+void Scheduler::setHandler(EventType type, std::function<void()> handler) {
+    handlers[type] = std::move(handler);
+}
+
+void Scheduler::schedule(EventType type, uint64_t at) {
+    when[type] = at;
+    updateNext();
+}
+
+void Scheduler::cancel(EventType type) {
+    when[type] = NEVER;
+    updateNext();
+}
+
+void Scheduler::updateNext() {
+    next = NEVER;
+    for (uint64_t t : when) {
+        if (t < next) next = t;
+    }
+}
+
+void Scheduler::dispatch() {
+    const uint64_t target = now;
+
+    // Fire in timestamp order; handlers see the clock at their own deadline and may reschedule
+    while (next <= target) {
+        int type = 0;
+        for (int i = 1; i < EVENT_COUNT; i++) {
+            if (when[i] < when[type]) type = i;
+        }
+
+        now = when[type];
+        when[type] = NEVER;
+        updateNext();
+        if (handlers[type])
+            handlers[type]();
+    }
+
+    now = target;
+}
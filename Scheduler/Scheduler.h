@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <functional>
+
+// event sources, one pending instance each
+enum EventType {
+    EVENT_TIMER_OVERFLOW,
+    EVENT_OAM_DMA,
+    EVENT_SERIAL,
+    // host-side events from here on, not part of the emulated machine
+    EVENT_STATS_DUMP,
+    EVENT_STATE_HASH,
+    EVENT_COUNT,
+};
+
+// Master clock in T-cycles plus a tiny fixed-slot event queue.
+// Devices that are evaluated lazily only need to be woken up at the handful of points where they
+// have an externally visible side effect (an interrupt), so instead of ticking them every cycle
+// they schedule the time of that side effect here.
+// A device that steps through a timed sequence (a PPU's modes, say) keeps its position in the
+// sequence as plain state and schedules the next step, rather than living in a coroutine: whole
+// machines are copied through clone() and copyStateFrom(), and a coroutine frame cannot be.
+class Scheduler {
+private:
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    std::array<uint64_t, EVENT_COUNT>              when;
+    std::array<std::function<void()>, EVENT_COUNT> handlers;
+    uint64_t next = NEVER;
+
+    void dispatch();
+    void updateNext();
+
+public:
+    uint64_t now = 0;
+
+    Scheduler();
+
+    void     reset(); // back to cycle 0 with nothing pending, handlers stay installed
+    void     copyStateFrom(const Scheduler& other); // clock and pending events, not handlers
+    uint64_t stateHash() const; // of the guest events' deadlines, relative to now
+
+    void     setHandler(EventType type, std::function<void()> handler);
+    void     schedule(EventType type, uint64_t at);
+    void     cancel(EventType type);
+    uint64_t nextEvent() const { return next; }
+
+    // Move the clock forward, firing every event that became due on the way
+    void advance(uint64_t t) {
+        now = t;
+        if (now >= next)
+            dispatch();
+    }
+};
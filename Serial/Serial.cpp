@@ -0,0 +1,111 @@
+#include "Serial.h"
+#include "../Log/Log.h"
+#include "../StateHash/StateHash.h"
+
+#include <iostream>
+
+Serial::Serial(Scheduler& sched, const Timer& timer, std::function<void()> requestInterrupt)
+    : sched(sched), timer(timer), requestInterrupt(std::move(requestInterrupt)), memtype(MEM_TYPE_REG) {
+    this->sched.setHandler(EVENT_SERIAL, [this] { finish(0xff); });
+}
+
+void Serial::reset() {
+    sb = 0;
+    sc = 0;
+    done = 0;
+    sched.cancel(EVENT_SERIAL);
+}
+
+void Serial::copyStateFrom(const Serial& other) {
+    sb   = other.sb;
+    sc   = other.sc;
+    done = other.done;
+    reschedule();
+}
+
+// Put the end of an internal-clock transfer in flight on the scheduler, unless a cable owns it
+void Serial::reschedule() {
+    if (transferring() && internalClock() && !linked)
+        sched.schedule(EVENT_SERIAL, done);
+    else
+        sched.cancel(EVENT_SERIAL);
+}
+
+uint64_t Serial::stateHash() const {
+    const uint8_t regs[] = {sb, sc};
+    // done is left over from the last transfer unless an internal-clock one is in flight
+    const uint64_t end = transferring() && internalClock() ? done - sched.now : 0;
+    return StateHash::mix(StateHash::bytes(regs, sizeof(regs)), end);
+}
+
+void Serial::setLinked(bool linked) {
+    this->linked = linked;
+    reschedule();
+}
+
+bool Serial::transferring() const {
+    return sc & 0x80;
+}
+
+bool Serial::internalClock() const {
+    return sc & 0x01;
+}
+
+uint64_t Serial::completion() const {
+    return done;
+}
+
+uint8_t Serial::finish(uint8_t in) {
+    GB_LOG(Log::LEVEL_TRACE, Log::CAT_INT, "Serial sent %02x, received %02x", sb, in);
+    const uint8_t out = sb;
+    std::cout << out; // test ROMs report over serial
+    if (onSerial) onSerial(out);
+
+    sb = in;
+    sc &= 0x7f;
+    sched.cancel(EVENT_SERIAL);
+    requestInterrupt();
+    return out;
+}
+
+// The clock is the divider's bit 8, so clearing the divider restarts the current bit and, with the
+// bit high, is itself a falling edge that shifts one out
+void Serial::dividerReset(uint16_t divider) {
+    if (!transferring() || !internalClock())
+        return;
+
+    uint64_t remaining = (done - sched.now + BIT_CYCLES - 1) / BIT_CYCLES;
+    if (divider & (BIT_CYCLES >> 1))
+        remaining--;
+    done = sched.now + remaining * BIT_CYCLES;
+    reschedule();
+}
+
+uint8_t Serial::read(uint16_t addr) {
+    return addr == 0xff01 ? sb : 0x7e | sc;
+}
+
+bool Serial::write(uint16_t addr, uint8_t val) {
+    if (addr == 0xff01) {
+        sb = val;
+        return true;
+    }
+
+    sc = val & 0x81;
+    if (!transferring())
+        return true;
+
+    done = timer.nextEdge(BIT_CYCLES) + 7 * BIT_CYCLES;
+    reschedule();
+    return true;
+}
+
+int Serial::getMemtype() {
+    return memtype;
+}
+
+int Serial::relativeUpdate(uint16_t addr, uint8_t val) {
+    uint8_t res = read(addr) + val;
+    write(addr, res);
+    return res;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "../memory/memory.h"
+#include "../Scheduler/Scheduler.h"
+#include "../Timer/Timer.h"
+
+// SB/SC (0xff01 - 0xff02).
+// Writing SC with bit 7 set starts a transfer of SB. With the internal clock (bit 0) it takes
+// 8 bits, one per falling edge of the divider's 8192 Hz tap; at its end SB holds the byte shifted in, bit 7 clears and the serial
+// interrupt is requested. With the external clock the port waits for a peer to drive it.
+// A transfer is modelled as one exchange of whole bytes at its end, so a byte counts as sent (and
+// reaches onSerial) when the transfer completes, with whatever SB holds by then.
+// On its own the port completes internal-clock transfers through the scheduler, shifting in
+// 0xff like an unconnected cable. Once plugged into a LinkCable the cable completes them
+// instead, by exchanging bytes with the other end.
+class Serial : public MemoryDevice {
+private:
+    Scheduler&   sched;
+    const Timer& timer; // the internal clock is a divider tap
+    std::function<void()> requestInterrupt;
+
+    uint8_t   sb = 0;
+    uint8_t   sc = 0;     // bits 7 and 0 as last written
+    uint64_t  done = 0;   // end of the internal-clock transfer in flight
+    bool      linked = false;
+    const int memtype;
+
+    void reschedule();
+
+public:
+    static constexpr uint64_t BIT_CYCLES      = 512;
+    static constexpr uint64_t TRANSFER_CYCLES = 8 * BIT_CYCLES; // one byte with the internal clock, at most
+    // and at least: the first edge can come a cycle after the start
+    static constexpr uint64_t MIN_TRANSFER_CYCLES = 7 * BIT_CYCLES + 1;
+
+    std::function<void(uint8_t)> onSerial; // called with every byte sent, when its transfer ends
+
+    Serial(Scheduler& sched, const Timer& timer, std::function<void()> requestInterrupt);
+
+    void     reset();
+    void     copyStateFrom(const Serial& other); // not the cable; the scheduler's copy carries the pending end
+    uint64_t stateHash() const; // of what copyStateFrom copies, the end relative to now
+
+    void     setLinked(bool linked);   // completion moves between the scheduler and a LinkCable
+    bool     transferring() const;     // SC bit 7
+    bool     internalClock() const;    // SC bit 0
+    uint64_t completion() const;       // end of the transfer in flight, if it is on the internal clock
+    uint8_t  finish(uint8_t in);       // shift in, end the transfer; returns the byte that was sent
+    void     dividerReset(uint16_t divider); // DIV was written while the divider stood at divider
+
+    uint8_t read(uint16_t addr) override;
+    bool    write(uint16_t addr, uint8_t val) override;
+    int     getMemtype() override;
+    int     relativeUpdate(uint16_t addr, uint8_t val) override;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// 64-bit hashing for machine state comparison (desync detection between runs or builds, not
+// security). Only values go in, never host pointers or sizes of host types, so equal guest
+// state hashes equal across builds (on little-endian hosts).
+namespace StateHash {
+
+inline uint64_t mix(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 29);
+}
+
+inline uint64_t bytes(const uint8_t* data, size_t n, uint64_t h = 0) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = mix(h, word);
+    }
+    for (; i < n; i++)
+        h = mix(h, data[i]);
+    return mix(h, n);
+}
+
+}
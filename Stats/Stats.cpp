@@ -0,0 +1,96 @@
+#include "Stats.h"
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <format>
+
+namespace Stats {
+
+// Registration only happens when instances are created or destroyed, never on the hot path
+static std::mutex                   registryMutex;
+static std::vector<const Counters*> registry;
+
+static const char* memTypeNames[MEM_TYPE_COUNT] = { "none", "rom", "ram", "vram", "reg" };
+static const char* interruptNames[INT_COUNT]    = { "vblank", "stat", "timer", "serial", "joypad" };
+static const char* fusionNames[FUSE_COUNT]      = { "copy-byte", "dec-jrnz", "dec16-jrnz", "ldh-cp-jr", "copy-loop", "fill-loop" };
+
+Counters::Counters() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.push_back(this);
+}
+
+Counters::~Counters() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.erase(std::find(registry.begin(), registry.end(), this));
+}
+
+void Counters::reset() {
+    instructions.reset();
+    mcycles.reset();
+    haltedCycles.reset();
+    traceBytes.reset();
+    for (auto& c : interrupts) c.reset();
+    for (auto& c : busReads)   c.reset();
+    for (auto& c : busWrites)  c.reset();
+    for (auto& c : fusions)    c.reset();
+}
+
+Snapshot& Snapshot::operator+=(const Counters& c) {
+    instructions += c.instructions.get();
+    mcycles      += c.mcycles.get();
+    haltedCycles += c.haltedCycles.get();
+    traceBytes   += c.traceBytes.get();
+    for (int i = 0; i < INT_COUNT; i++) {
+        interrupts[i] += c.interrupts[i].get();
+    }
+    for (int i = 0; i < MEM_TYPE_COUNT; i++) {
+        busReads[i]  += c.busReads[i].get();
+        busWrites[i] += c.busWrites[i].get();
+    }
+    for (int i = 0; i < FUSE_COUNT; i++) {
+        fusions[i] += c.fusions[i].get();
+    }
+    instances++;
+    return *this;
+}
+
+Snapshot snapshot(const Counters& c) {
+    Snapshot s;
+    s += c;
+    return s;
+}
+
+Snapshot aggregate() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Snapshot s;
+    for (const Counters* c : registry) {
+        s += *c;
+    }
+    return s;
+}
+
+void dump(std::ostream& out, const Snapshot& s) {
+    out << std::format("instances {}  instructions {}  m-cycles {}  halted {}  trace bytes {}\n",
+        s.instances, s.instructions, s.mcycles, s.haltedCycles, s.traceBytes);
+
+    out << "interrupts";
+    for (int i = 0; i < INT_COUNT; i++) {
+        out << std::format("  {} {}", interruptNames[i], s.interrupts[i]);
+    }
+    out << "\nbus reads ";
+    for (int i = 0; i < MEM_TYPE_COUNT; i++) {
+        out << std::format("  {} {}", memTypeNames[i], s.busReads[i]);
+    }
+    out << "\nbus writes";
+    for (int i = 0; i < MEM_TYPE_COUNT; i++) {
+        out << std::format("  {} {}", memTypeNames[i], s.busWrites[i]);
+    }
+    out << "\nfusions   ";
+    for (int i = 0; i < FUSE_COUNT; i++) {
+        out << std::format("  {} {}", fusionNames[i], s.fusions[i]);
+    }
+    out << "\n";
+}
+
+}
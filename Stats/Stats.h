@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <ostream>
+
+#include "../memory/memory.h"
+#include "../InterruptController/InterruptController.h"
+#include "../LR35902/Fusion.h"
+
+namespace Stats {
+
+// Counter with a single writer, the emulation thread that owns the instance. Increments are a
+// relaxed load + store (a plain add on x86, no lock prefix); other threads may read it at any
+// time and see a slightly stale but never torn value.
+class Counter {
+private:
+    std::atomic<uint64_t> v{0};
+
+public:
+    void     inc(uint64_t n = 1) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t get() const         { return v.load(std::memory_order_relaxed); }
+    void     reset()             { v.store(0, std::memory_order_relaxed); }
+};
+
+// Per-instance counters, registered globally for the lifetime of the object
+struct Counters {
+    Counter instructions;
+    Counter mcycles;
+    Counter haltedCycles;
+    Counter traceBytes;
+    Counter interrupts[INT_COUNT];
+    Counter busReads[MEM_TYPE_COUNT];
+    Counter busWrites[MEM_TYPE_COUNT];
+    Counter fusions[FUSE_COUNT]; // superinstructions executed, by kind
+
+    Counters();
+    ~Counters();
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    void reset();
+};
+
+// Plain copy of a set of counters, or of their sum over instances
+struct Snapshot {
+    uint64_t instructions = 0;
+    uint64_t mcycles = 0;
+    uint64_t haltedCycles = 0;
+    uint64_t traceBytes = 0;
+    uint64_t interrupts[INT_COUNT] = {};
+    uint64_t busReads[MEM_TYPE_COUNT] = {};
+    uint64_t busWrites[MEM_TYPE_COUNT] = {};
+    uint64_t fusions[FUSE_COUNT] = {};
+    uint64_t instances = 0;
+
+    Snapshot& operator+=(const Counters& c);
+};
+
+Snapshot snapshot(const Counters& c);
+Snapshot aggregate(); // sum over every live instance
+void     dump(std::ostream& out, const Snapshot& s);
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+// Fixed set of worker threads for fork-join loops.
+// parallelFor() hands out indices from a shared counter, so uneven items balance themselves,
+// and the calling thread works through the loop too instead of just waiting for it.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex               mutex;
+    std::condition_variable  wake;
+    std::condition_variable  done;
+
+    const std::function<void(size_t)>* job = nullptr;
+    size_t              jobSize = 0;
+    std::atomic<size_t> nextIndex{0};
+    size_t              active = 0;     // workers still inside the current job
+    uint64_t            generation = 0; // bumped once per job
+    bool                stopping = false;
+    std::exception_ptr  error;
+
+    void workerLoop();
+    void drain();
+
+public:
+    explicit ThreadPool(unsigned threads = 0); // 0 picks one thread per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const; // threads working a loop, including the caller
+
+    // Run fn(0) .. fn(n - 1) and return once all of them have finished. The first exception
+    // thrown by fn is rethrown here.
+    void parallelFor(size_t n, const std::function<void(size_t)>& fn);
+};
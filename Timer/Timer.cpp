@@ -0,0 +1,150 @@
+#include "Timer.h"
+#include "../Log/Log.h"
+#include "../StateHash/StateHash.h"
+
+// TAC clock select -> TIMA period in T-cycles
+static const uint64_t TACVariants[] = { 1024, 16, 64, 256 };
+
+Timer::Timer(Scheduler& sched, std::function<void()> requestInterrupt)
+    : sched(sched), requestInterrupt(std::move(requestInterrupt)), memtype(MEM_TYPE_REG) {
+    divBase = syncTime = sched.now;
+    sched.setHandler(EVENT_TIMER_OVERFLOW, [this] { overflow(); });
+}
+
+void Timer::reset() {
+    divBase = syncTime = sched.now;
+    tima = tma = tac = 0;
+    sched.cancel(EVENT_TIMER_OVERFLOW);
+}
+
+void Timer::setDivider(uint16_t value) {
+    sync();
+    divBase = sched.now - value;
+    reschedule();
+}
+
+void Timer::copyStateFrom(const Timer& other) {
+    divBase  = other.divBase;
+    syncTime = other.syncTime;
+    tima = other.tima;
+    tma  = other.tma;
+    tac  = other.tac;
+}
+
+uint64_t Timer::stateHash() const {
+    const uint8_t regs[] = {tma, tac};
+    return StateHash::mix(StateHash::bytes(regs, sizeof(regs)), uint16_t(sched.now - divBase));
+}
+
+uint64_t Timer::nextEdge(uint64_t period) const {
+    return sched.now + period - (sched.now - divBase) % period;
+}
+
+bool Timer::enabled() const {
+    return tac & 0x04;
+}
+
+uint64_t Timer::period() const {
+    return TACVariants[tac & 0x03];
+}
+
+// TIMA ticks on the falling edge of divider bit (period / 2), i.e. every time the divider
+// crosses a multiple of the period. Count those crossings in (from, to].
+uint64_t Timer::edges(uint64_t from, uint64_t to) const {
+    if (!enabled())
+        return 0;
+    const uint64_t p = period();
+    return (to - divBase) / p - (from - divBase) / p;
+}
+
+// The AND of the enable bit and the selected divider bit, which is what TIMA is clocked from
+bool Timer::signal() const {
+    return enabled() && (uint16_t(sched.now - divBase) & (period() >> 1));
+}
+
+void Timer::sync() {
+    // Overflows are delivered by the scheduler at their exact cycle, so this never wraps
+    tima += edges(syncTime, sched.now);
+    syncTime = sched.now;
+}
+
+void Timer::increment() {
+    if (++tima == 0) {
+        tima = tma;
+        requestInterrupt();
+    }
+}
+
+void Timer::reschedule() {
+    if (!enabled()) {
+        sched.cancel(EVENT_TIMER_OVERFLOW);
+        return;
+    }
+
+    const uint64_t p = period();
+    const uint64_t edge = (sched.now - divBase) / p + (0x100 - tima);
+    sched.schedule(EVENT_TIMER_OVERFLOW, divBase + edge * p);
+}
+
+void Timer::overflow() {
+    GB_LOG(Log::LEVEL_TRACE, Log::CAT_TIMER, "TIMA overflow, reloading %02x", tma);
+    tima = tma;
+    syncTime = sched.now;
+    requestInterrupt();
+    reschedule();
+}
+
+uint8_t Timer::read(uint16_t addr) {
+    switch (addr) {
+        case 0xff04: return uint8_t(uint16_t(sched.now - divBase) >> 8);
+        case 0xff05: return uint8_t(tima + edges(syncTime, sched.now));
+        case 0xff06: return tma;
+        case 0xff07: return tac | 0xf8;
+    }
+    return 0xff;
+}
+
+bool Timer::write(uint16_t addr, uint8_t val) {
+    sync();
+
+    switch (addr) {
+        case 0xff04: { // Any write resets the divider, which can drop the selected bit
+            bool before = signal();
+            const uint16_t divider = uint16_t(sched.now - divBase);
+            divBase = sched.now;
+            if (before)
+                increment();
+            if (onDividerReset)
+                onDividerReset(divider);
+            break;
+        }
+        case 0xff05: {
+            tima = val;
+            break;
+        }
+        case 0xff06: {
+            tma = val;
+            break;
+        }
+        case 0xff07: { // Disabling the timer or switching bits can also produce a falling edge
+            bool before = signal();
+            tac = val & 0x07;
+            if (before && !signal())
+                increment();
+            break;
+        }
+    }
+
+    reschedule();
+    return true;
+}
+
+int Timer::getMemtype() {
+    return memtype;
+}
+
+int Timer::relativeUpdate(uint16_t addr, uint8_t val) {
+    uint8_t res = read(addr) + val;
+    write(addr, res);
+    return res;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "../memory/memory.h"
+#include "../Scheduler/Scheduler.h"
+
+// DIV/TIMA/TMA/TAC (0xff04 - 0xff07), evaluated lazily.
+// The internal 16-bit divider is a pure function of the master clock, and TIMA is only
+// materialized when it is read or when TAC/DIV/TIMA are written. The only work done while the
+// guest ignores the timer is a single scheduler event at the next TIMA overflow.
+class Timer : public MemoryDevice {
+private:
+    Scheduler& sched;
+    std::function<void()> requestInterrupt;
+
+    uint64_t divBase  = 0; // master cycle at which the internal divider was last zero
+    uint64_t syncTime = 0; // master cycle at which tima was last brought up to date
+    uint8_t  tima = 0;
+    uint8_t  tma  = 0;
+    uint8_t  tac  = 0;
+    const int memtype;
+
+    bool     enabled() const;
+    uint64_t period() const;
+    uint64_t edges(uint64_t from, uint64_t to) const;
+    bool     signal() const;
+    void     sync();
+    void     increment();
+    void     reschedule();
+    void     overflow();
+
+public:
+    std::function<void(uint16_t)> onDividerReset; // called on DIV writes with the divider value they cleared
+
+    Timer(Scheduler& sched, std::function<void()> requestInterrupt);
+
+    void    reset(); // power-on state, relative to the scheduler's current clock
+    void    setDivider(uint16_t value); // load the internal divider, as left by a boot ROM
+    void    copyStateFrom(const Timer& other); // the scheduler's copy carries the pending overflow
+    uint64_t stateHash() const; // of the divider and the registers that are not materialized lazily
+
+    uint64_t nextEdge(uint64_t period) const; // first cycle after now where the divider is a multiple of period
+
+    uint8_t read(uint16_t addr) override;
+    bool    write(uint16_t addr, uint8_t val) override;
+    int     getMemtype() override;
+    int     relativeUpdate(uint16_t addr, uint8_t val) override;
+};
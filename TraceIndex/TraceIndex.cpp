@@ -0,0 +1,274 @@
+#include "TraceIndex.h"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char     indexMagic[4] = {'G', 'B', 'T', 'I'};
+const uint32_t indexVersion  = 2;
+
+// The trace's size and mtime when it was indexed; an index that doesn't match is stale
+struct IndexHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t stride;
+    uint32_t firstHits;
+    uint64_t traceSize;
+    int64_t  traceMtime; // nanoseconds
+    uint64_t lines;
+    uint64_t offsetCount;
+    uint64_t firstCount;
+};
+
+struct FirstEntry {
+    uint64_t line;
+    uint16_t pc;
+    uint8_t  pad[6];
+};
+
+// PC of a trace line, -1 if the line has no parsable PC: field
+int parsePC(const char* line, size_t len) {
+    const void* at = memmem(line, len, "PC:", 3);
+    if (!at)
+        return -1;
+    const char* p = static_cast<const char*>(at) + 3;
+    if (p + 4 > line + len)
+        return -1;
+
+    int pc = 0;
+    for (int i = 0; i < 4; i++) {
+        char ch = p[i];
+        int digit;
+        if (ch >= '0' && ch <= '9')      digit = ch - '0';
+        else if (ch >= 'A' && ch <= 'F') digit = ch - 'A' + 10;
+        else if (ch >= 'a' && ch <= 'f') digit = ch - 'a' + 10;
+        else return -1;
+        pc = pc << 4 | digit;
+    }
+    return pc;
+}
+
+int64_t mtimeOf(const struct stat& st) {
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// Maps a whole file read-only. Returns nullptr for an empty file.
+const char* mapFile(const std::string& path, int& fd, size_t& size) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open trace: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Failed to stat trace: " + path);
+    }
+    size = st.st_size;
+    if (size == 0)
+        return nullptr;
+
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map trace: " + path);
+    }
+    return static_cast<const char*>(p);
+}
+
+}
+
+std::string traceIndexPath(const std::string& tracePath) {
+    return tracePath + ".idx";
+}
+
+TraceIndexer::TraceIndexer(uint32_t stride, uint32_t firstHits) : stride(stride), firstHits(firstHits) {
+    if (stride == 0)
+        throw std::invalid_argument("Trace index stride must be non-zero");
+    if (firstHits > UINT8_MAX)
+        throw std::invalid_argument("Trace index keeps at most 255 first hits per PC");
+}
+
+void TraceIndexer::add(uint64_t offset, uint16_t pc) {
+    if (lines % stride == 0)
+        offsets.push_back(offset);
+
+    if (hitCount[pc] < firstHits) {
+        hitCount[pc]++;
+        firsts.emplace_back(pc, lines);
+    }
+    lines++;
+}
+
+void TraceIndexer::write(const std::string& tracePath) {
+    const std::string path = traceIndexPath(tracePath);
+    struct stat st;
+    if (stat(tracePath.c_str(), &st) != 0)
+        throw std::runtime_error("Failed to stat trace: " + tracePath);
+
+    // Lines were added in order, so a stable sort by pc keeps each pc's visits oldest first
+    std::stable_sort(firsts.begin(), firsts.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open())
+        throw std::runtime_error("Failed to open trace index: " + path);
+
+    IndexHeader header{};
+    memcpy(header.magic, indexMagic, 4);
+    header.version     = indexVersion;
+    header.stride      = stride;
+    header.firstHits   = firstHits;
+    header.traceSize   = st.st_size;
+    header.traceMtime  = mtimeOf(st);
+    header.lines       = lines;
+    header.offsetCount = offsets.size();
+    header.firstCount  = firsts.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+    for (const auto& [pc, line] : firsts) {
+        FirstEntry e{};
+        e.line = line;
+        e.pc   = pc;
+        out.write(reinterpret_cast<const char*>(&e), sizeof(e));
+    }
+}
+
+TraceIndexer TraceIndexer::build(const std::string& tracePath, uint32_t stride, uint32_t firstHits) {
+    TraceIndexer index(stride, firstHits);
+
+    int fd;
+    size_t size;
+    const char* data = mapFile(tracePath, fd, size);
+    if (data)
+        madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+
+    size_t pos = 0;
+    while (pos < size) {
+        const char* nl = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+        size_t end = nl ? nl - data : size;
+
+        int pc = parsePC(data + pos, end - pos);
+        index.add(pos, pc < 0 ? 0 : pc);
+        pos = end + 1;
+    }
+
+    if (data)
+        munmap(const_cast<char*>(data), size);
+    close(fd);
+    return index;
+}
+
+TraceFile::TraceFile(const std::string& tracePath) {
+    data = mapFile(tracePath, fd, size);
+    if (data)
+        madvise(const_cast<char*>(data), size, MADV_RANDOM);
+
+    if (!loadIndex(tracePath)) {
+        TraceIndexer built = TraceIndexer::build(tracePath);
+        std::stable_sort(built.firsts.begin(), built.firsts.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        stride  = built.stride;
+        lines   = built.lines;
+        offsets = std::move(built.offsets);
+        firsts  = std::move(built.firsts);
+    }
+}
+
+bool TraceFile::loadIndex(const std::string& tracePath) {
+    std::ifstream in(traceIndexPath(tracePath), std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    IndexHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || memcmp(header.magic, indexMagic, 4) != 0)
+        throw std::runtime_error("Not a trace index: " + traceIndexPath(tracePath));
+
+    // Older versions and indexes of a trace that has since been rewritten are ignored
+    struct stat st;
+    if (header.version != indexVersion || fstat(fd, &st) != 0
+        || header.traceSize != size || header.traceMtime != mtimeOf(st)
+        || header.stride == 0 || header.offsetCount != (header.lines + header.stride - 1) / header.stride)
+        return false;
+
+    stride = header.stride;
+    lines  = header.lines;
+    offsets.resize(header.offsetCount);
+    in.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+    firsts.reserve(header.firstCount);
+    for (uint64_t i = 0; i < header.firstCount && in; i++) {
+        FirstEntry e;
+        in.read(reinterpret_cast<char*>(&e), sizeof(e));
+        firsts.emplace_back(e.pc, e.line);
+    }
+    if (!in)
+        throw std::runtime_error("Truncated trace index: " + traceIndexPath(tracePath));
+
+    for (uint64_t i = 0; i < offsets.size(); i++) {
+        if (offsets[i] > size || (i && offsets[i] < offsets[i - 1]))
+            throw std::runtime_error("Corrupt trace index: " + traceIndexPath(tracePath));
+    }
+    for (const auto& [pc, line] : firsts) {
+        if (line >= lines)
+            throw std::runtime_error("Corrupt trace index: " + traceIndexPath(tracePath));
+    }
+    return true;
+}
+
+TraceFile::~TraceFile() {
+    if (data)
+        munmap(const_cast<char*>(data), size);
+    if (fd >= 0)
+        close(fd);
+}
+
+uint64_t TraceFile::lineCount() const {
+    return lines;
+}
+
+std::string_view TraceFile::line(uint64_t n) const {
+    std::string_view r = range(n, 1);
+    if (!r.empty() && r.back() == '\n')
+        r.remove_suffix(1);
+    return r;
+}
+
+std::string_view TraceFile::range(uint64_t first, uint64_t count) const {
+    if (first >= lines || count == 0)
+        return {};
+    count = std::min(count, lines - first);
+
+    // Jump to the nearest indexed line, then walk at most stride - 1 lines forward
+    size_t start = offsets[first / stride];
+    if (start > size)
+        return {};
+    for (uint64_t i = first % stride; i > 0; i--) {
+        const char* nl = static_cast<const char*>(memchr(data + start, '\n', size - start));
+        start = nl ? nl - data + 1 : size;
+    }
+
+    size_t end = start;
+    for (uint64_t i = 0; i < count && end < size; i++) {
+        const char* nl = static_cast<const char*>(memchr(data + end, '\n', size - end));
+        end = nl ? nl - data + 1 : size;
+    }
+    return std::string_view(data + start, end - start);
+}
+
+std::vector<uint64_t> TraceFile::firstVisits(uint16_t pc) const {
+    auto lo = std::lower_bound(firsts.begin(), firsts.end(), std::make_pair(pc, uint64_t(0)));
+
+    std::vector<uint64_t> visits;
+    for (auto it = lo; it != firsts.end() && it->first == pc; ++it)
+        visits.push_back(it->second);
+    return visits;
+}
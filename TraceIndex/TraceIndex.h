@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <utility>
+
+// Sparse index over a gameboy-doctor trace (one line per instruction).
+// Every stride-th line gets its byte offset recorded, and the first few lines that start at each
+// PC are kept, so a reader can seek to instruction N or to the first visits of an address with
+// one lookup and a short scan instead of reading the whole file.
+// The index lives next to the trace as <trace>.idx, stamped with the trace's size and mtime.
+class TraceIndexer {
+private:
+    uint32_t stride;
+    uint32_t firstHits;
+    uint64_t lines = 0;
+
+    std::vector<uint64_t>                       offsets;  // offset of line k * stride
+    std::array<uint8_t, 0x10000>                hitCount{}; // so firstHits is at most 255
+    std::vector<std::pair<uint16_t, uint64_t>>  firsts;   // (pc, line)
+
+    friend class TraceFile;
+
+public:
+    TraceIndexer(uint32_t stride = 1024, uint32_t firstHits = 16); // firstHits up to 255
+
+    // Record the next line, starting at byte offset in the trace and executing at pc
+    void add(uint64_t offset, uint16_t pc);
+    void write(const std::string& tracePath); // to <trace>.idx, once the trace is complete and closed
+
+    // Index an existing trace after the fact
+    static TraceIndexer build(const std::string& tracePath, uint32_t stride = 1024, uint32_t firstHits = 16);
+};
+
+// Read-only view of an indexed trace. The trace is mmap'ed, so queries only touch the pages
+// holding the lines they return.
+class TraceFile {
+private:
+    const char* data = nullptr;
+    size_t      size = 0;
+    int         fd = -1;
+
+    uint32_t stride = 0;
+    uint64_t lines = 0;
+    std::vector<uint64_t>                      offsets;
+    std::vector<std::pair<uint16_t, uint64_t>> firsts; // sorted by pc, then line
+
+    bool loadIndex(const std::string& tracePath); // false if there is none or it is stale
+
+public:
+    // Loads <tracePath>.idx, or indexes the trace in memory if there is none or it is stale
+    explicit TraceFile(const std::string& tracePath);
+    ~TraceFile();
+
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+
+    uint64_t         lineCount() const;
+    std::string_view line(uint64_t n) const;                    // without the trailing newline
+    std::string_view range(uint64_t first, uint64_t count) const; // whole lines, newlines included
+    std::vector<uint64_t> firstVisits(uint16_t pc) const;       // line numbers, oldest first
+};
+
+std::string traceIndexPath(const std::string& tracePath);
@@ -0,0 +1,110 @@
+#include "VecEnv.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+VecEnv::VecEnv(std::shared_ptr<const ROMImage> rom, size_t count, std::vector<ObsRange> obs,
+               Model model, unsigned threads, const MachineOptions& options)
+    : ranges(std::move(obs)), model(model), pool(threads)
+    , applyAction([](Machine& m, uint8_t action) { m.joypad().setButtons(action); }) {
+    if (!options.savePath.empty())
+        throw std::invalid_argument("VecEnv machines cannot share a battery save");
+    for (const ObsRange& r : ranges)
+        obsSize += r.length;
+
+    machines.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        machines.push_back(makeMachine(options));
+        machines.back()->loadROM(rom);
+    }
+}
+
+size_t VecEnv::size() const {
+    return machines.size();
+}
+
+size_t VecEnv::observationSize() const {
+    return obsSize;
+}
+
+Machine& VecEnv::machine(size_t i) {
+    return *machines[i];
+}
+
+void VecEnv::setActionHandler(std::function<void(Machine&, uint8_t)> handler) {
+    applyAction = std::move(handler);
+}
+
+void VecEnv::observe(size_t i, uint8_t* out) {
+    Machine& m = *machines[i];
+    for (const ObsRange& r : ranges) {
+        for (uint16_t j = 0; j < r.length; j++)
+            *out++ = m.peek(r.start + j); // the host looking, not the guest reading
+    }
+}
+
+void VecEnv::resetAll(uint8_t* obs) {
+    pool.parallelFor(machines.size(), [&](size_t i) {
+        machines[i]->reset(model);
+        if (obs)
+            observe(i, obs + i * obsSize);
+    });
+}
+
+void VecEnv::stepAll(const uint8_t* actions, int frames, uint8_t* obs) {
+    if (frames < 0)
+        throw std::invalid_argument("VecEnv step frame count must not be negative");
+
+    pool.parallelFor(machines.size(), [&](size_t i) {
+        Machine& m = *machines[i];
+        if (applyAction && actions)
+            applyAction(m, actions[i]);
+
+        // Watchpoints only pause a debug machine, a step always covers the full frames
+        const uint64_t until = m.scheduler().now + frames * FRAME_CYCLES;
+        while (m.run(until) < until) {
+            if (Watchpoints* wp = m.watchpoints())
+                wp->hit = false;
+        }
+
+        if (obs)
+            observe(i, obs + i * obsSize);
+    });
+}
+
+extern "C" {
+
+void* gb_vecenv_create(const char* romPath, size_t count, const uint16_t* obsStarts,
+                       const uint16_t* obsLengths, size_t obsRanges, unsigned threads) {
+    try {
+        std::vector<ObsRange> ranges;
+        for (size_t i = 0; i < obsRanges; i++)
+            ranges.push_back(ObsRange{obsStarts[i], obsLengths[i]});
+        return new VecEnv(ROMImage::load(romPath), count, std::move(ranges), MODEL_DMG, threads);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "gb_vecenv_create: %s\n", e.what());
+        return nullptr;
+    }
+}
+
+void gb_vecenv_destroy(void* env) {
+    delete static_cast<VecEnv*>(env);
+}
+
+size_t gb_vecenv_observation_size(void* env) {
+    return static_cast<VecEnv*>(env)->observationSize();
+}
+
+void gb_vecenv_reset(void* env, uint8_t* obs) {
+    static_cast<VecEnv*>(env)->resetAll(obs);
+}
+
+void gb_vecenv_step(void* env, const uint8_t* actions, int frames, uint8_t* obs) {
+    try {
+        static_cast<VecEnv*>(env)->stepAll(actions, frames, obs);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "gb_vecenv_step: %s\n", e.what());
+    }
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "../Machine/Machine.h"
+#include "../ThreadPool/ThreadPool.h"
+
+// one contiguous piece of the address space copied into every observation
+struct ObsRange {
+    uint16_t start;
+    uint16_t length;
+};
+
+// Lockstep batch of machines for training loops.
+// stepAll() applies one action per machine, runs every machine for the same number of frames
+// on a thread pool and writes all observations into one caller-owned array, so a whole batch
+// costs one call instead of one round trip per machine. An observation is the concatenation of
+// the configured RAM ranges; there is no PPU, so no framebuffer observation yet.
+class VecEnv {
+private:
+    std::vector<std::unique_ptr<Machine>> machines;
+    std::vector<ObsRange> ranges;
+    size_t     obsSize = 0;
+    Model      model;
+    ThreadPool pool;
+    std::function<void(Machine&, uint8_t)> applyAction;
+
+    void observe(size_t i, uint8_t* out);
+
+public:
+    static constexpr uint64_t FRAME_CYCLES = Machine::FRAME_CYCLES;
+
+    // options.savePath has to be empty: every machine would map the same file as its cartridge RAM
+    VecEnv(std::shared_ptr<const ROMImage> rom, size_t count, std::vector<ObsRange> obs,
+           Model model = MODEL_DMG, unsigned threads = 0, const MachineOptions& options = {});
+
+    size_t   size() const;
+    size_t   observationSize() const; // bytes per machine
+    Machine& machine(size_t i);
+
+    // How an action byte reaches the machine. By default it is the Joypad button mask held
+    // for the whole step; a handler can map it to something else, e.g. a RAM poke.
+    void setActionHandler(std::function<void(Machine&, uint8_t)> handler);
+
+    // obs must hold size() * observationSize() bytes, machine i's observation at i * observationSize()
+    void resetAll(uint8_t* obs);
+    void stepAll(const uint8_t* actions, int frames, uint8_t* obs);
+};
+
+// C interface for driving a VecEnv from other languages (e.g. Python through ctypes)
+extern "C" {
+    void*  gb_vecenv_create(const char* romPath, size_t count, const uint16_t* obsStarts,
+                            const uint16_t* obsLengths, size_t obsRanges, unsigned threads);
+    void   gb_vecenv_destroy(void* env);
+    size_t gb_vecenv_observation_size(void* env);
+    void   gb_vecenv_reset(void* env, uint8_t* obs);
+    void   gb_vecenv_step(void* env, const uint8_t* actions, int frames, uint8_t* obs);
+}
@@ -6,11 +6,20 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <format>
 
 #include "memory/memory.h"
 #include "Reg8/Reg8.h"
 #include "Reg16/Reg16.h"
 #include "LR35902/LR35902.h"
+#include "Machine/Machine.h"
+#include "Profiler/Profiler.h"
+#include "TraceIndex/TraceIndex.h"
+#include "FlightRecorder/FlightRecorder.h"
+#include "Stats/Stats.h"
+#include "Log/Log.h"
+#include "Movie/Movie.h"
+#include "RunAhead/RunAhead.h"
 #include "testing/testing.h"
 #include "json.hpp"
 using json = nlohmann::json;
@@ -22,78 +31,57 @@ void printBytesHex(const std::vector<uint8_t>& data) {
     std::printf("\n");
 }
 
-std::vector<uint8_t> loadFile(const std::string& src) {
-    std::ifstream f{src, std::ios::binary | std::ios::ate};
-    if(!f.is_open()) {
-        throw std::runtime_error("Failed to open file: " + src);
-    }
-    std::streamsize size = f.tellg();
-    f.seekg(0, std::ios::beg);
-
-    std::vector<uint8_t> buffer(size);
-    if(!f.read(reinterpret_cast<char*>(buffer.data()), size)) {
-        throw std::runtime_error("Failed to read file: " + src);
+int main() {
+    const std::string romPath  = "test_roms/02-interrupts.gb";
+    const Model       model    = MODEL_DMG; // post-boot state to start from, no boot ROM needed
+    const std::string savePath = ""; // e.g. "test_roms/game.sav" to back cartridge RAM with a battery save, unused with a movie
+    const bool        debug    = false; // build the machine on the watchpoint-capable bus
+    const bool        trace    = true;  // gameboy-doctor log of every instruction
+    const bool        indexTrace = true; // write <log>.idx for tools/traceidx alongside the trace
+    const bool        profile  = false;
+    const std::string symPath  = ""; // RGBDS .sym file used to name profiled addresses
+    const bool        record   = false; // keep the last instructions and dump them when a trigger fires
+    const std::string recordPath = "flight.txt";
+    const std::string recordSerial = "Failed"; // serial output that triggers a dump
+    const uint64_t    statsInterval = 0; // T-cycles between stats dumps, 0 disables them
+    const std::string moviePath = ""; // replay this input movie (model from the movie) instead of a fixed run
+    const int         runAheadFrames = 0; // with a movie, also run this many frames ahead and report the cost
+    const std::string hashPath = ""; // state hash at every frame boundary, diff two logs for the first diverging frame
+    const bool        selfTest = false; // run the tests that need no fixture files and exit
+
+    if (selfTest)
+        return Testing::runSelfTests() ? 0 : 1;
+
+    Log::start();
+
+    MachineOptions options;
+    options.debug    = debug;
+    options.trace    = trace;
+    options.profile  = profile;
+    options.record   = record;
+    options.savePath = moviePath.empty() ? savePath : ""; // a replay loads the movie's RAM, not the battery save
+    std::unique_ptr<Machine> machine = makeMachine(options);
+    Scheduler& sched = machine->scheduler();
+
+    printf("Loading %s...\n", romPath.c_str());
+    machine->loadROM(ROMImage::load(romPath));
+    Movie movie;
+    if (!moviePath.empty()) {
+        movie = Movie::load(moviePath);
+        movie.begin(*machine);
+    } else {
+        machine->reset(model);
     }
-
-    return buffer;
-}
-
-void insertROM(Bus& bus, const std::string& src, int offset = 0) {
-    printf("Loading %s...\n", src.c_str());
-    auto ROM = loadFile(src);
-
-    printf("Inserting %s into memory through the bus...\n", src.c_str());
-    for (int addr = 0; addr < ROM.size(); ++addr) {
-        if(addr <= 0xffff)
-            bus.write(addr + offset, ROM[addr]);
+    const std::string logPath = "../gameboy-doctor/log.txt";
+    std::ofstream logfile;
+    TraceIndexer* traceIndex = nullptr;
+    if (trace || debug) {
+        logfile.open(logPath);
+        if (indexTrace)
+            traceIndex = new TraceIndexer();
+        machine->setTrace(&logfile, traceIndex);
     }
 
-    printf("Done!\n");
-}
-
-int main() {
-    Bus bus;
-    ROMBlock* ROMBank0              = new ROMBlock(0x0000, 0x4000);
-    ROMBlock* ROMBankSwitchable0    = new ROMBlock(0x4000, 0x4000);
-    RAMBlock* VRAM                  = new RAMBlock(0x8000, 0x2000);
-    RAMBlock* RAMBankSwitchable0    = new RAMBlock(0xa000, 0x2000);
-    RAMBlock* RAMInternal           = new RAMBlock(0xc000, 0x2000);
-    RAMBlock* loop                  = new RAMBlock(0xe000, 0x1e00); // TODO: Implement proper echo-ram
-    REGBlock* RegisterMem           = new REGBlock(0xfe00, 0x01ff);
-
-    bus.mapRange(0, 0x3fff, ROMBank0);
-    bus.mapRange(0x4000, 0x7fff, ROMBankSwitchable0);
-    bus.mapRange(0x8000, 0x9fff, VRAM);
-    bus.mapRange(0xa000, 0xbfff, RAMBankSwitchable0);
-    bus.mapRange(0xc000, 0xdfff, RAMInternal);
-    bus.mapRange(0xe000, 0xfdff, loop); /* Echo RAM */
-    bus.mapRange(0xfe00, 0xffff, RegisterMem); /* Mostly registers */
-
-    CPU::LR35902 core(bus);
-
-    json postBootState = {
-        {"a", 0x01},
-        {"f", 0xb0}, 
-        {"b", 0x00}, 
-        {"c", 0x13}, 
-        {"d", 0x00}, 
-        {"e", 0xd8}, 
-        {"h", 0x01},
-        {"l", 0x4d},
-        {"sp", 0xfffe},
-        {"pc", 0x0100}, 
-    };
-    core.setRegisterStateJSON(postBootState);
-
-    insertROM(bus, "test_roms/02-interrupts.gb");
-    //insertROM(bus, "test_roms/dmg_boot.bin");
-    std::ofstream logfile("../gameboy-doctor/log.txt");
-    core.streamAppendState(logfile);
-    bus.read(0xff04); // Divider Register   DIV
-    bus.read(0xff05); // Timer Counter      TIMA
-    bus.read(0xff06); // Timer Modulo       TMA
-    bus.read(0xff07); // Timer Control      TAC
-
     /*
     static const uint8_t nintendo_logo[48] = {
         0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B,
@@ -105,52 +93,85 @@ int main() {
     };
 
     for(int i = 0; i < 48; i++)
-        bus.write(0x104 + i, nintendo_logo[i]);
+        machine->poke(0x104 + i, nintendo_logo[i]);
     
-    printf("%x\n", bus.read(0x0104));
+    printf("%x\n", machine->read(0x0104));
     */
 
-    long long tcycle = 0;
-    long long maxtcycles = 1e6 * 16;
-    int TACVariants[] = { 1024, 16, 64, 256 };
+    Profiler* profiler = nullptr;
+    if (profile) {
+        profiler = new Profiler();
+        if (!symPath.empty())
+            profiler->loadSymbols(symPath);
+        machine->attachProfiler(profiler);
+    }
+
+    FlightRecorder* recorder = nullptr;
+    if (record) {
+        recorder = new FlightRecorder(4096, recordPath);
+        recorder->setSerialPattern(recordSerial);
+        machine->attachFlightRecorder(recorder);
+    }
 
-    while (tcycle < maxtcycles) {
-        if ((tcycle & 0b11) == 0) {
-            if (core.insCycle()) {
-                core.streamAppendState(logfile);
-            }
-        }
-        tcycle++;
+    if (statsInterval) {
+        sched.setHandler(EVENT_STATS_DUMP, [&sched, statsInterval] {
+            Stats::dump(std::cout, Stats::aggregate());
+            sched.schedule(EVENT_STATS_DUMP, sched.now + statsInterval);
+        });
+        sched.schedule(EVENT_STATS_DUMP, statsInterval);
+    }
 
-        if ((tcycle & 0xFF) == 0xFF) {
-            bus.relativeUpdate(0xFF04, true);
-        }
+    // One line per frame; the instruction count is the trace line to look at with tools/traceidx
+    std::ofstream hashLog;
+    if (!hashPath.empty()) {
+        hashLog.open(hashPath);
+        Machine* m = machine.get();
+        sched.setHandler(EVENT_STATE_HASH, [m, &sched, &hashLog] {
+            hashLog << std::format("frame {} instructions {} hash {:016x}\n", sched.now / Machine::FRAME_CYCLES,
+                                   m->stats().instructions.get(), m->stateHash());
+            sched.schedule(EVENT_STATE_HASH, sched.now + Machine::FRAME_CYCLES);
+        });
+        sched.schedule(EVENT_STATE_HASH, sched.now + Machine::FRAME_CYCLES);
+    }
+
+    uint64_t maxtcycles = 1e6 * 16;
 
-        uint8_t tac = bus.read(0xFF07);
-        bool timerEnable = (tac & 0x04) != 0;      // Check TAC.bit2
-        int clockSelect = (tac & 0x03);            // TAC bits 1–0
-        int period = TACVariants[clockSelect];     // 1024, 16, 64, or 256
-
-        if (timerEnable) {
-            if ((tcycle & (period - 1)) == (period - 1)) {
-                bool noOverflow = bus.relativeUpdate(0xFF05, true);
-
-                if (!noOverflow) {
-                    bus.write(0xFF0F, bus.read(0xFF0F) | 0x04); 
-                    bus.write(0xFF05, bus.read(0xFF06));
-                    core.halt = false;
-                }
-            }
+    if (!moviePath.empty()) {
+        printf("Replaying %zu frames of %s\n", movie.frames.size(), moviePath.c_str());
+        if (runAheadFrames > 0) {
+            RunAhead ahead(*machine, runAheadFrames);
+            for (uint8_t buttons : movie.frames)
+                ahead.frame(buttons);
+            ahead.report(std::cout);
         }
+        // Without run-ahead this plays the whole movie, with it there is nothing left to play
+        maxtcycles = movie.play(*machine, runAheadFrames > 0 ? movie.frames.size() : 0);
     }
 
-    delete ROMBank0;
-    delete ROMBankSwitchable0;
-    delete VRAM;
-    delete RAMBankSwitchable0;
-    delete RAMInternal;
-    delete RegisterMem;
-    printf("Memory freed successfully");
+    // run() only returns early when a watchpoint fires on the debug machine
+    while (machine->run(maxtcycles) < maxtcycles) {
+        Watchpoints* wp = machine->watchpoints();
+        printf("Watchpoint hit at %04x (kind %d, value %02x)\n", wp->last.addr, wp->last.kind, wp->last.val);
+        wp->hit = false;
+    }
+
+    Stats::dump(std::cout, Stats::snapshot(machine->stats()));
+
+    if (profiler) {
+        std::ofstream folded("profile.folded");
+        profiler->writeFolded(folded);
+        profiler->writeHotspots(std::cout);
+        delete profiler;
+    }
+
+    delete recorder;
+
+    if (traceIndex) {
+        logfile.close(); // the index is stamped with the final size of the trace
+        traceIndex->write(logPath);
+        delete traceIndex;
+    }
 
+    Log::stop();
     return 0;
 }
@@ -1,26 +1,90 @@
 #include "memory.h"
+#include "../StateHash/StateHash.h"
+
+#include <cstring>
+#include <algorithm>
+#include "watchpoints.h"
+#include "romimage.h"
+#include "../Stats/Stats.h"
 
 // ROMBlock implementation
+static const uint8_t blankBank[0x4000] = {}; // what an empty cartridge slot reads as
+
 ROMBlock::ROMBlock(uint16_t offset, uint16_t size)
-    : offset(offset), size(size), memtype(MEM_TYPE_ROM) {
+    : data(blankBank), offset(offset), size(size), memtype(MEM_TYPE_ROM) {
     if (size > 0x4000)
         throw std::invalid_argument("ROMBlock size exceeds limit");
 }
 
+ROMBlock::~ROMBlock() = default;
+
+void ROMBlock::attach(std::shared_ptr<const ROMImage> rom, size_t bank) {
+    image = std::move(rom);
+    selectBank(bank);
+}
+
+void ROMBlock::selectBank(size_t bank) {
+    this->bank = bank;
+    priv.reset();
+
+    const size_t start = bank * ROMImage::BANK_SIZE;
+    if (image && start + size <= image->size()) {
+        data = image->data() + start;
+        return;
+    }
+
+    // Past the end of the image (or no image at all): a short last bank is padded with 0xff
+    data = blankBank;
+    if (image && start < image->size()) {
+        detach();
+        memset(priv.get(), 0xff, size);
+        memcpy(priv.get(), image->data() + start, image->size() - start);
+    }
+}
+
+void ROMBlock::copyStateFrom(const ROMBlock& other) {
+    attach(other.image, other.bank);
+    if (other.priv) {
+        detach();
+        memcpy(priv.get(), other.priv.get(), size);
+    }
+}
+
+void ROMBlock::reset() {
+    selectBank(bank);
+}
+
+void ROMBlock::detach() {
+    if (priv)
+        return;
+    priv = std::make_unique<uint8_t[]>(size);
+    memcpy(priv.get(), data, size);
+    data = priv.get();
+}
+
 uint8_t ROMBlock::read(uint16_t addr) {
     return data[addr - offset];
 }
 
-bool ROMBlock::write(uint16_t addr, uint8_t val) {
-    return data[addr - offset] = val;
+const uint8_t* ROMBlock::span(uint16_t addr) {
+    return data + (addr - offset);
+}
+
+bool ROMBlock::write(uint16_t, uint8_t) {
+    return false;
+}
+
+void ROMBlock::poke(uint16_t addr, uint8_t val) {
+    detach();
+    priv[addr - offset] = val;
 }
 
 int ROMBlock::getMemtype() {
     return memtype;
 }
 
-int ROMBlock::relativeUpdate(uint16_t addr, uint8_t val) {
-    return data[addr - offset] += val;
+int ROMBlock::relativeUpdate(uint16_t addr, uint8_t) {
+    return data[addr - offset];
 }
 
 // RAMBlock implementation
@@ -30,12 +94,16 @@ RAMBlock::RAMBlock(uint16_t offset, uint16_t size)
         throw std::invalid_argument("RAMBlock size exceeds limit");
 }
 
+void RAMBlock::reset() {
+    memset(data, 0, size);
+}
+
 uint8_t RAMBlock::read(uint16_t addr) {
-    return data[addr - offset];
+    return data[(addr - offset) & 0x1fff];
 }
 
 bool RAMBlock::write(uint16_t addr, uint8_t val) {
-    return data[addr - offset] = val;
+    return data[(addr - offset) & 0x1fff] = val;
 }
 
 int RAMBlock::getMemtype() {
@@ -43,14 +111,22 @@ int RAMBlock::getMemtype() {
 }
 
 int RAMBlock::relativeUpdate(uint16_t addr, uint8_t val) {
-    return data[addr - offset] += val;
+    return data[(addr - offset) & 0x1fff] += val;
 }
 
 // REGBlock implementation
 REGBlock::REGBlock(uint16_t offset, uint16_t size)
     : offset(offset), size(size), memtype(MEM_TYPE_REG) {
-    if (size > 0x2000)
-        throw std::invalid_argument("RAMBlock size exceeds limit");
+    if (size > 0x200)
+        throw std::invalid_argument("REGBlock size exceeds limit");
+}
+
+void REGBlock::reset() {
+    memset(data, 0, size);
+}
+
+void REGBlock::copyStateFrom(const REGBlock& other) {
+    memcpy(data, other.data, size);
 }
 
 uint8_t REGBlock::read(uint16_t addr) {
@@ -64,23 +140,6 @@ uint8_t REGBlock::read(uint16_t addr) {
 }
 
 bool REGBlock::write(uint16_t addr, uint8_t val) {
-    switch(addr) {
-        case 0xff02: { // Write to serial
-            if(val & 0x80)
-                std::cout << data[0xff01 - offset]; // Output serial data
-
-            break;
-        }
-        case 0xff04: { // Write to Divider Register
-            data[addr - offset] = 0x00;
-            break;
-        }
-        case 0xff0f: { // Write to IF
-            //printf("Write %02x to 0xff0f (IF)\n", val);
-            break;
-        }
-    }
-
     return data[addr - offset] = val;
 }
 
@@ -93,44 +152,357 @@ int REGBlock::relativeUpdate(uint16_t addr, uint8_t val) {
 }
 
 // Bus implementation
-Bus::Bus() = default;
+template<class Debug>
+BasicBus<Debug>::BasicBus()
+    : stats(new Stats::Counters()) {}
+
+template<class Debug>
+BasicBus<Debug>::~BasicBus() {
+    delete stats;
+}
 
-void Bus::mapRange(uint16_t start, uint16_t end, MemoryDevice* dev) {
-    for (int i = start; i <= end; ++i) {
-        map[i] = dev;
+template<class Debug>
+void BasicBus<Debug>::mapRange(uint16_t start, uint16_t end, MemoryDevice* dev) {
+    for (int page = start >> 8; page <= end >> 8; ++page) {
+        const int first = std::max<int>(start, page << 8);
+        const int last  = std::min<int>(end, (page << 8) | 0xff);
+
+        if (pages[page].mem) {
+            pages[page].mem = nullptr;
+            buffers[page].reset();
+        }
+
+        if (first == page << 8 && last == ((page << 8) | 0xff)) {
+            pages[page].dev = dev;
+            fine[page].reset();
+        } else {
+            // Only part of the page changes hands, so it needs per-address entries
+            if (!fine[page]) {
+                fine[page] = std::make_unique<PageMap>();
+                fine[page]->fill(pages[page].dev);
+            }
+            for (int a = first; a <= last; ++a)
+                (*fine[page])[a & 0xff] = dev;
+        }
+        pages[page].type = dev ? dev->getMemtype() : MEM_TYPE_DNE;
+    }
+}
+
+template<class Debug>
+void BasicBus<Debug>::mapMemory(uint16_t start, uint16_t end, int memtype) {
+    if ((start & 0xff) != 0 || (end & 0xff) != 0xff)
+        throw std::invalid_argument("Memory ranges must cover whole pages");
+
+    for (int page = start >> 8; page <= end >> 8; ++page) {
+        buffers[page] = std::make_shared<uint8_t[]>(PAGE_SIZE);
+        fine[page].reset();
+        pages[page] = Page{nullptr, buffers[page].get(), true, DIRTY_ALL, uint8_t(memtype)};
     }
 }
 
-uint32_t Bus::read(uint16_t addr, int n) {
+template<class Debug>
+void BasicBus<Debug>::mirrorRange(uint16_t start, uint16_t end, uint16_t source) {
+    if ((start & 0xff) != 0 || (end & 0xff) != 0xff || (source & 0xff) != 0)
+        throw std::invalid_argument("Mirrored ranges must cover whole pages");
+
+    for (int page = start >> 8, src = source >> 8; page <= end >> 8; ++page, ++src) {
+        if (!pages[src].mem)
+            throw std::invalid_argument("Only memory pages can be mirrored");
+        buffers[page] = buffers[src];
+        fine[page].reset();
+        pages[page] = pages[src];
+    }
+}
+
+template<class Debug>
+void BasicBus<Debug>::clearMemory() {
+    for (int page = 0; page < 0x100; ++page) {
+        if (pages[page].mem && pages[page].owned)
+            memset(pages[page].mem, 0, PAGE_SIZE);
+        pages[page].dirty = pages[page].mem ? DIRTY_ALL : 0;
+    }
+
+    // Shared pages are not ours to clear; give them (and their mirrors) fresh zeroed buffers
+    for (int page = 0; page < 0x100; ++page) {
+        if (pages[page].mem && !pages[page].owned) {
+            uint8_t* old = pages[page].mem;
+            auto buf = std::make_shared<uint8_t[]>(PAGE_SIZE);
+            for (int q = page; q < 0x100; ++q) {
+                if (pages[q].mem == old) {
+                    buffers[q] = buf;
+                    pages[q].mem = buf.get();
+                    pages[q].owned = true;
+                }
+            }
+        }
+    }
+}
+
+template<class Debug>
+void BasicBus<Debug>::shareMemory(BasicBus& parent) {
+    for (int page = 0; page < 0x100; ++page) {
+        if (!parent.pages[page].mem)
+            continue;
+        if (pages[page].dev || fine[page])
+            throw std::invalid_argument("Bus layouts differ, cannot share memory");
+
+        parent.pages[page].owned = false;
+        buffers[page] = parent.buffers[page];
+        pages[page] = parent.pages[page];
+        pages[page].dirty = DIRTY_ALL; // new contents as far as this bus's snapshots and hash go
+    }
+}
+
+template<class Debug>
+size_t BasicBus<Debug>::ownedPages() const {
+    // A mirrored buffer is counted once, at the first page that uses it
+    size_t n = 0;
+    for (int page = 0; page < 0x100; ++page) {
+        if (!pages[page].mem || !pages[page].owned)
+            continue;
+        bool mirror = false;
+        for (int q = 0; q < page && !mirror; ++q)
+            mirror = pages[q].mem == pages[page].mem;
+        n += !mirror;
+    }
+    return n;
+}
+
+// Give a shared memory page a private copy, updating every page that mirrors it
+template<class Debug>
+void BasicBus<Debug>::detach(int page) {
+    uint8_t* old = pages[page].mem;
+    auto buf = std::make_shared<uint8_t[]>(PAGE_SIZE);
+    memcpy(buf.get(), old, PAGE_SIZE);
+
+    for (int q = 0; q < 0x100; ++q) {
+        if (pages[q].mem == old) {
+            buffers[q] = buf;
+            pages[q].mem = buf.get();
+            pages[q].owned = true;
+        }
+    }
+}
+
+template<class Debug>
+void BasicBus<Debug>::touch(int page) {
+    if (!pages[page].owned)
+        detach(page);
+    for (int q = 0; q < 0x100; ++q) {
+        if (pages[q].mem == pages[page].mem)
+            pages[q].dirty = DIRTY_ALL;
+    }
+}
+
+template<class Debug>
+void BasicBus<Debug>::takeDirtyPages(const std::function<void(int, const uint8_t*)>& visit) {
+    for (int page = 0; page < 0x100; ++page) {
+        if (!pages[page].mem || !(pages[page].dirty & DIRTY_SNAPSHOT))
+            continue;
+        bool mirror = false;
+        for (int q = 0; q < page && !mirror; ++q)
+            mirror = pages[q].mem == pages[page].mem;
+        if (!mirror)
+            visit(page, pages[page].mem);
+    }
+    for (Page& page : pages)
+        page.dirty &= ~DIRTY_SNAPSHOT;
+}
+
+template<class Debug>
+uint64_t BasicBus<Debug>::memoryHash() {
+    uint64_t h = 0;
+    for (int page = 0; page < 0x100; ++page) {
+        if (!pages[page].mem)
+            continue;
+        if (pages[page].dirty & DIRTY_HASH) {
+            pageHashes[page] = StateHash::bytes(pages[page].mem, PAGE_SIZE);
+            pages[page].dirty &= ~DIRTY_HASH;
+        }
+        h = StateHash::mix(h, (uint64_t(page) << 56) ^ pageHashes[page]);
+    }
+    return h;
+}
+
+template<class Debug>
+void BasicBus<Debug>::loadPage(int page, const uint8_t* data) {
+    if (!pages[page].mem)
+        throw std::invalid_argument("Only memory pages can be loaded");
+    touch(page);
+    memcpy(pages[page].mem, data, PAGE_SIZE);
+}
+
+template<class Debug>
+uint32_t BasicBus<Debug>::read(uint16_t addr, int n) {
     uint32_t result = 0;
     for (int i = 0; i < n; ++i) {
         uint16_t a = addr + i;
-        uint8_t byte = map[a] ? map[a]->read(a) : 0x00;
+        const Page& page = pages[a >> 8];
+        uint8_t byte;
+        if (page.mem) {
+            byte = page.mem[a & 0xff];
+        } else {
+            MemoryDevice* dev = device(a);
+            byte = dev ? dev->read(a) : 0x00;
+        }
+        stats->busReads[page.type].inc();
+        if constexpr (Debug::enabled) debug.check(a, WATCH_READ, byte);
         result |= uint32_t(byte) << (8 * i);
     }
     return result;
 }
 
-void Bus::write(uint16_t addr, uint8_t val) {
-    if (auto dev = map[addr])
+template<class Debug>
+uint8_t BasicBus<Debug>::peek(uint16_t addr) {
+    if (uint8_t* mem = pages[addr >> 8].mem)
+        return mem[addr & 0xff];
+    MemoryDevice* dev = device(addr);
+    return dev ? dev->read(addr) : 0x00;
+}
+
+template<class Debug>
+void BasicBus<Debug>::write(uint16_t addr, uint8_t val) {
+    Page& page = pages[addr >> 8];
+    stats->busWrites[page.type].inc();
+    if constexpr (Debug::enabled) debug.check(addr, WATCH_WRITE, val);
+
+    if (page.mem) {
+        if (!(page.owned & (page.dirty == DIRTY_ALL)))
+            touch(addr >> 8);
+        page.mem[addr & 0xff] = val;
+    } else if (auto dev = device(addr)) {
         dev->write(addr, val);
+    }
+}
+
+template<class Debug>
+void BasicBus<Debug>::poke(uint16_t addr, uint8_t val) {
+    Page& page = pages[addr >> 8];
+    if (page.mem) {
+        if (!(page.owned & (page.dirty == DIRTY_ALL)))
+            touch(addr >> 8);
+        page.mem[addr & 0xff] = val;
+    } else if (auto dev = device(addr)) {
+        dev->poke(addr, val);
+    }
 }
 
-int Bus::getMemtype(uint16_t addr) {
-    return map[addr] ? map[addr]->getMemtype() : MEM_TYPE_DNE;
+template<class Debug>
+const uint8_t* BasicBus<Debug>::source(uint16_t addr) {
+    const Page& page = pages[addr >> 8];
+    if (page.mem)
+        return page.mem + (addr & 0xff);
+    if (fine[addr >> 8] || !page.dev)
+        return nullptr;
+    return page.dev->span(addr);
 }
 
-bool Bus::isMapFull() {
-    for (const auto& dev : map) {
-        if (dev == nullptr) return false;
+template<class Debug>
+bool BasicBus<Debug>::copyBlock(uint16_t dst, uint16_t src, uint32_t n) {
+    if constexpr (Debug::enabled)
+        return false; // watchpoints have to see every access
+
+    if (n == 0 || dst + n > 0x10000 || src + n > 0x10000)
+        return false;
+    for (uint32_t page = dst >> 8; page <= (dst + n - 1) >> 8; ++page) {
+        if (!pages[page].mem)
+            return false;
+    }
+    for (uint32_t page = src >> 8; page <= (src + n - 1) >> 8; ++page) {
+        if (!source(page << 8))
+            return false;
+    }
+
+    for (uint32_t done = 0; done < n;) {
+        const uint16_t d = dst + done;
+        const uint16_t s = src + done;
+        const uint32_t len = std::min({n - done, PAGE_SIZE - uint32_t(d & 0xff), PAGE_SIZE - uint32_t(s & 0xff)});
+
+        // Copy-on-write first, it may move a mirror of the source too
+        Page& to = pages[d >> 8];
+        if (!(to.owned & (to.dirty == DIRTY_ALL)))
+            touch(d >> 8);
+        uint8_t*       out = to.mem + (d & 0xff);
+        const uint8_t* in  = source(s);
+
+        if (uintptr_t(in) + len <= uintptr_t(out) || uintptr_t(out) + len <= uintptr_t(in)) {
+            memcpy(out, in, len);
+        } else {
+            // Overlapping runs repeat bytes exactly like the guest loop does
+            for (uint32_t i = 0; i < len; ++i)
+                out[i] = in[i];
+        }
+
+        stats->busReads[pages[s >> 8].type].inc(len);
+        stats->busWrites[to.type].inc(len);
+        done += len;
     }
     return true;
 }
 
-int Bus::relativeUpdate(uint16_t addr, uint8_t val) {
+template<class Debug>
+bool BasicBus<Debug>::fillBlock(uint16_t dst, uint8_t val, uint32_t n) {
+    if constexpr (Debug::enabled)
+        return false;
+
+    if (n == 0 || dst + n > 0x10000)
+        return false;
+    for (uint32_t page = dst >> 8; page <= (dst + n - 1) >> 8; ++page) {
+        if (!pages[page].mem)
+            return false;
+    }
+
+    for (uint32_t done = 0; done < n;) {
+        const uint16_t d = dst + done;
+        const uint32_t len = std::min(n - done, PAGE_SIZE - uint32_t(d & 0xff));
+
+        Page& to = pages[d >> 8];
+        if (!(to.owned & (to.dirty == DIRTY_ALL)))
+            touch(d >> 8);
+        memset(to.mem + (d & 0xff), val, len);
+
+        stats->busWrites[to.type].inc(len);
+        done += len;
+    }
+    return true;
+}
+
+template<class Debug>
+void BasicBus<Debug>::countReads(uint16_t addr, uint64_t n) {
+    stats->busReads[pages[addr >> 8].type].inc(n);
+}
+
+template<class Debug>
+int BasicBus<Debug>::getMemtype(uint16_t addr) {
+    if (pages[addr >> 8].mem)
+        return pages[addr >> 8].type;
+    MemoryDevice* dev = device(addr);
+    return dev ? dev->getMemtype() : MEM_TYPE_DNE;
+}
+
+template<class Debug>
+bool BasicBus<Debug>::isMapFull() {
+    for (int addr = 0; addr <= 0xffff; ++addr) {
+        if (!pages[addr >> 8].mem && device(addr) == nullptr) return false;
+    }
+    return true;
+}
+
+template<class Debug>
+int BasicBus<Debug>::relativeUpdate(uint16_t addr, uint8_t val) {
     if(!val)
         return -1;
 
-    if (auto dev = map[addr])
+    Page& page = pages[addr >> 8];
+    if (page.mem) {
+        if (!(page.owned & (page.dirty == DIRTY_ALL)))
+            touch(addr >> 8);
+        return page.mem[addr & 0xff] += val;
+    }
+    if (auto dev = device(addr))
         return dev->relativeUpdate(addr, val);
+    return -1;
 }
+
+template class BasicBus<NoDebug>;
+template class BasicBus<Watchpoints>;
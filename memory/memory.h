@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <array>
+#include <memory>
 #include <stdexcept>
 #include <iostream>
 
@@ -12,8 +14,12 @@ enum MemType {
     MEM_TYPE_RAM,
     MEM_TYPE_VRAM,
     MEM_TYPE_REG,
+    MEM_TYPE_COUNT,
 };
 
+namespace Stats { struct Counters; }
+class ROMImage;
+
 // abstract memory device interface
 class MemoryDevice {
 public:
@@ -21,27 +27,45 @@ public:
     virtual bool    write(uint16_t addr, uint8_t val) = 0;
     virtual int     getMemtype() = 0;
     virtual int     relativeUpdate(uint16_t addr, uint8_t val) = 0;
+    virtual const uint8_t* span(uint16_t) { return nullptr; } // host pointer for reads without side effects, to the end of the page
+    virtual void    poke(uint16_t addr, uint8_t val) { write(addr, val); } // test harness write, see BasicBus::poke()
     virtual ~MemoryDevice() = default;
 };
 
-// ROM block
+// ROM block, a window onto one bank of a shared ROMImage.
+// Guest writes are dropped: on a cartridge they go to the MBC, and there is no MBC yet. The
+// image is never written; a poke (the test harness putting code into ROM space) gives this block
+// a private copy of its bank, until the next selectBank() or reset().
 class ROMBlock : public MemoryDevice {
 private:
-    uint8_t  data[0x4000];
+    std::shared_ptr<const ROMImage> image;
+    const uint8_t*             data;    // selected bank, in the image or in priv
+    std::unique_ptr<uint8_t[]> priv;    // private copy once written to
+    size_t   bank = 0;
     uint16_t offset;
     uint16_t size;
     const int memtype;
 
+    void detach();
+
 public:
     ROMBlock(uint16_t offset, uint16_t size);
+    ~ROMBlock() override;
+
+    void    attach(std::shared_ptr<const ROMImage> rom, size_t bank);
+    void    selectBank(size_t bank);
+    void    copyStateFrom(const ROMBlock& other); // same image and bank, pokes copied
+    void    reset(); // drop poked bytes
 
     uint8_t read(uint16_t addr) override;
     bool    write(uint16_t addr, uint8_t val) override;
+    void    poke(uint16_t addr, uint8_t val) override;
     int     getMemtype() override;
     int     relativeUpdate(uint16_t addr, uint8_t val) override;
+    const uint8_t* span(uint16_t addr) override;
 };
 
-// RAM block
+// RAM block. Accesses wrap at 8KB, so the block can also be mapped as its own echo.
 class RAMBlock : public MemoryDevice {
 private:
     uint8_t  data[0x2000];
@@ -52,6 +76,8 @@ private:
 public:
     RAMBlock(uint16_t offset, uint16_t size);
 
+    void    reset(); // clear contents, keeping the mapping
+
     uint8_t read(uint16_t addr) override;
     bool    write(uint16_t addr, uint8_t val) override;
     int     getMemtype() override;
@@ -61,7 +87,7 @@ public:
 // REG block for registers (preliminary, subject to change when developing this emulator)
 class REGBlock : public MemoryDevice {
 private:
-    uint8_t  data[0x2000];
+    uint8_t  data[0x200];
     uint16_t offset;
     uint16_t size;
     const int memtype;
@@ -69,24 +95,106 @@ private:
 public:
     REGBlock(uint16_t offset, uint16_t size);
 
+    void    reset(); // clear contents, keeping the mapping
+    void    copyStateFrom(const REGBlock& other);
+
     uint8_t read(uint16_t addr) override;
     bool    write(uint16_t addr, uint8_t val) override;
     int     getMemtype() override;
     int     relativeUpdate(uint16_t addr, uint8_t val) override;
 };
 
-// address bus
-class Bus {
+// consumers of a memory page's dirty bits
+enum DirtyBit : uint8_t {
+    DIRTY_SNAPSHOT = 1,
+    DIRTY_HASH     = 2,
+    DIRTY_ALL      = 3,
+};
+
+// bus debug policy for normal runs, every check compiles away
+struct NoDebug {
+    static constexpr bool enabled = false;
+    bool check(uint16_t, int, uint8_t) { return false; }
+};
+
+// address bus, parameterized on a debug policy (see watchpoints.h)
+// Everything is looked up per 256-byte page. A page is either plain memory (WRAM, VRAM), read
+// and written straight through a host pointer, or belongs to a device. The few pages shared by
+// several devices (the I/O page) get a per-address device table of their own.
+// Memory pages are reference counted so a cloned machine can share them with its parent; a page
+// that is not owned is copied on its first write.
+// Memory pages also carry dirty bits, one per consumer (incremental snapshots, the state hash). The
+// first write to a page after either consumer looked at it takes the same slow path as a
+// copy-on-write, so plain writes pay nothing extra.
+template<class Debug>
+class BasicBus {
 private:
-    std::array<MemoryDevice*, 0x10000> map{};
+    static constexpr int PAGE_SIZE = 0x100;
+
+    using PageMap = std::array<MemoryDevice*, PAGE_SIZE>;
+
+    struct Page {
+        MemoryDevice* dev   = nullptr;
+        uint8_t*      mem   = nullptr; // host memory of a memory page
+        bool          owned = false;   // mem is not shared with another bus
+        uint8_t       dirty = 0;       // DirtyBits of the consumers that have not seen the last write
+        uint8_t       type  = MEM_TYPE_DNE;
+    };
+
+    std::array<Page, 0x100>                       pages{};
+    std::array<std::shared_ptr<uint8_t[]>, 0x100> buffers; // keep each page's mem alive
+    std::array<std::unique_ptr<PageMap>, 0x100>   fine;
+    std::array<uint64_t, 0x100>                   pageHashes{}; // as of the last memoryHash()
+
+    MemoryDevice* device(uint16_t addr) const {
+        const PageMap* f = fine[addr >> 8].get();
+        return f ? (*f)[addr & 0xff] : pages[addr >> 8].dev;
+    }
+
+    void detach(int page);
+    void touch(int page); // make a memory page writable and dirty
+    const uint8_t* source(uint16_t addr); // host pointer to read from, nullptr if the page has none
 
 public:
-    Bus();
+    using DebugPolicy = Debug;
+
+    Stats::Counters* stats; // always-on per-instance counters
+    bool dmaLock = false;   // OAM DMA owns the external bus, the CPU only reaches 0xff00 - 0xffff
+    [[no_unique_address]] Debug debug;
+
+    BasicBus();
+    ~BasicBus();
+    BasicBus(const BasicBus&) = delete;
+    BasicBus& operator=(const BasicBus&) = delete;
 
     void        mapRange(uint16_t start, uint16_t end, MemoryDevice* dev);
+    void        mapMemory(uint16_t start, uint16_t end, int memtype); // whole pages, zeroed
+    void        mirrorRange(uint16_t start, uint16_t end, uint16_t source); // alias memory pages
+    void        clearMemory();
+    void        shareMemory(BasicBus& parent); // adopt its memory pages; both sides copy on their next write
+    size_t      ownedPages() const;
+    // Every memory page dirtied since the last call, once per buffer (a mirror is reported at its
+    // first page), as visit(page, data); all of them count as clean again afterwards
+    void        takeDirtyPages(const std::function<void(int, const uint8_t*)>& visit);
+    void        loadPage(int page, const uint8_t* data); // overwrite a memory page with 256 bytes
+    uint64_t    memoryHash(); // of all memory pages, rehashing only those written since the last call
+
     uint32_t    read(uint16_t addr, int n = 1);
+    uint8_t     peek(uint16_t addr); // read without accounting or watchpoints
     void        write(uint16_t addr, uint8_t val);
+    // Write without accounting or watchpoints that also reaches ROM, for setting up test states.
+    // Devices other than ROM see it as a normal write.
+    void        poke(uint16_t addr, uint8_t val);
     int         getMemtype(uint16_t addr);
     bool        isMapFull();
     int         relativeUpdate(uint16_t addr, uint8_t val);
+
+    // Bulk transfers for native loop execution (see fusion.cpp). Each moves n bytes in order,
+    // with the accounting of n single accesses, but only over memory pages (and reads from devices
+    // with a span). Anything else returns false before touching memory.
+    bool        copyBlock(uint16_t dst, uint16_t src, uint32_t n);
+    bool        fillBlock(uint16_t dst, uint8_t val, uint32_t n);
+    void        countReads(uint16_t addr, uint64_t n); // account for n reads of addr without doing them
 };
+
+using Bus = BasicBus<NoDebug>;
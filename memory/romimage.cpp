@@ -0,0 +1,43 @@
+#include "romimage.h"
+
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+ROMImage::ROMImage(std::vector<uint8_t> bytes) : bytes(std::move(bytes)) {}
+
+std::shared_ptr<const ROMImage> ROMImage::load(const std::string& path) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<const ROMImage>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto cached = cache[path].lock())
+        return cached;
+
+    std::ifstream f{path, std::ios::binary | std::ios::ate};
+    if (!f.is_open())
+        throw std::runtime_error("Failed to open file: " + path);
+    std::streamsize size = f.tellg();
+    f.seekg(0, std::ios::beg);
+
+    std::vector<uint8_t> buffer(size);
+    if (!f.read(reinterpret_cast<char*>(buffer.data()), size))
+        throw std::runtime_error("Failed to read file: " + path);
+
+    auto image = std::make_shared<const ROMImage>(std::move(buffer));
+    cache[path] = image;
+    return image;
+}
+
+const uint8_t* ROMImage::data() const {
+    return bytes.data();
+}
+
+size_t ROMImage::size() const {
+    return bytes.size();
+}
+
+size_t ROMImage::banks() const {
+    return (bytes.size() + BANK_SIZE - 1) / BANK_SIZE;
+}
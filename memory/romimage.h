@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+// Immutable cartridge image.
+// Machines hold it through a shared_ptr and only keep their own bank selection, so any number
+// of instances running one game share a single copy of the ROM. load() caches images by path
+// for as long as some machine still references them.
+class ROMImage {
+private:
+    std::vector<uint8_t> bytes;
+
+public:
+    static constexpr size_t BANK_SIZE = 0x4000;
+
+    explicit ROMImage(std::vector<uint8_t> bytes);
+
+    static std::shared_ptr<const ROMImage> load(const std::string& path);
+
+    const uint8_t* data() const;
+    size_t         size() const;
+    size_t         banks() const; // 16KB banks, the last one possibly partial
+};
@@ -0,0 +1,220 @@
+#include "saveram.h"
+#include "../StateHash/StateHash.h"
+#include "../Log/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// One msync thread for every persistent block in the process, however many machines there are.
+// Each block is flushed on its own interval; the registry lock is held while flushing so a block
+// being destroyed waits for a flush in progress instead of racing it
+class Flusher {
+private:
+    struct Entry {
+        SaveRAMBlock*                         block;
+        std::chrono::milliseconds             interval;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    std::vector<Entry>      blocks;
+    bool                    started = false;
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            if (blocks.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+
+            auto due = blocks[0].due;
+            for (const Entry& e : blocks)
+                due = std::min(due, e.due);
+            if (cv.wait_until(lock, due) != std::cv_status::timeout)
+                continue; // registry changed, recompute
+
+            const auto now = std::chrono::steady_clock::now();
+            for (Entry& e : blocks) {
+                if (e.due <= now) {
+                    e.block->flush();
+                    e.due = now + e.interval;
+                }
+            }
+        }
+    }
+
+public:
+    void add(SaveRAMBlock* block, std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks.push_back({block, interval, std::chrono::steady_clock::now() + interval});
+        // Started once and left running: it only sleeps while no block is registered
+        if (!started) {
+            std::thread(&Flusher::loop, this).detach();
+            started = true;
+        }
+        cv.notify_one();
+    }
+
+    void remove(SaveRAMBlock* block) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::erase_if(blocks, [block](const Entry& e) { return e.block == block; });
+        cv.notify_one();
+    }
+};
+
+// Never destroyed, so the detached thread can't outlive it at exit
+Flusher& flusher() {
+    static Flusher* instance = new Flusher();
+    return *instance;
+}
+
+}
+
+SaveRAMBlock::SaveRAMBlock(uint16_t offset, uint16_t size, const std::string& path, std::chrono::milliseconds interval)
+    : offset(offset), size(size), memtype(MEM_TYPE_RAM) {
+    if (size > 0x2000)
+        throw std::invalid_argument("SaveRAMBlock size exceeds limit");
+
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    while ((size_t(1) << pageShift) < pageSize)
+        pageShift++;
+    mapped = (size_t(size) + pageSize - 1) & ~(pageSize - 1);
+
+    if (path.empty()) {
+        void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::runtime_error("Failed to allocate cartridge RAM");
+        data = static_cast<uint8_t*>(p);
+        return;
+    }
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open save file: " + path);
+
+    // A fresh (or short) save file is zero-extended so the whole block is backed by the file
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t(st.st_size) < mapped && ftruncate(fd, mapped) != 0)) {
+        close(fd);
+        throw std::runtime_error("Failed to size save file: " + path);
+    }
+
+    void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map save file: " + path);
+    }
+    data = static_cast<uint8_t*>(p);
+
+    flusher().add(this, interval);
+}
+
+SaveRAMBlock::~SaveRAMBlock() {
+    if (fd >= 0)
+        flusher().remove(this);
+
+    flush();
+    munmap(data, mapped);
+    if (fd >= 0)
+        close(fd);
+}
+
+uint8_t SaveRAMBlock::read(uint16_t addr) {
+    return data[addr - offset];
+}
+
+bool SaveRAMBlock::write(uint16_t addr, uint8_t val) {
+    const uint16_t rel = addr - offset;
+    data[rel] = val;
+    written  |= 1u << (rel >> 8);
+    unhashed |= 1u << (rel >> 8);
+
+    // Only pay for the atomic RMW the first time a page is dirtied between flushes
+    const uint64_t bit = uint64_t(1) << (rel >> pageShift);
+    if (!(dirty.load(std::memory_order_relaxed) & bit))
+        dirty.fetch_or(bit, std::memory_order_release);
+
+    return val;
+}
+
+int SaveRAMBlock::getMemtype() {
+    return memtype;
+}
+
+int SaveRAMBlock::relativeUpdate(uint16_t addr, uint8_t val) {
+    uint8_t res = data[addr - offset] + val;
+    write(addr, res);
+    return res;
+}
+
+void SaveRAMBlock::copyStateFrom(const SaveRAMBlock& other) {
+    const uint16_t n = std::min(size, other.size);
+    memcpy(data, other.data, n);
+    written = unhashed = ~0u;
+    if (n)
+        dirty.fetch_or((uint64_t(2) << ((n - 1) >> pageShift)) - 1, std::memory_order_release);
+}
+
+void SaveRAMBlock::takeWrittenPages(const std::function<void(uint16_t, const uint8_t*)>& visit) {
+    for (uint32_t page = 0; page << 8 < size; page++) {
+        if (written & (1u << page))
+            visit(offset + (page << 8), data + (page << 8));
+    }
+    written = 0;
+}
+
+void SaveRAMBlock::loadPage(uint16_t addr, const uint8_t* page) {
+    const uint16_t rel = addr - offset;
+    if (rel >= size || (rel & 0xff))
+        throw std::invalid_argument("Not a cartridge RAM page");
+    const uint16_t n = std::min<uint16_t>(0x100, size - rel);
+    memcpy(data + rel, page, n);
+    written  |= 1u << (rel >> 8);
+    unhashed |= 1u << (rel >> 8);
+    dirty.fetch_or((uint64_t(2) << ((rel + n - 1) >> pageShift)) - (uint64_t(1) << (rel >> pageShift)), std::memory_order_release);
+}
+
+uint64_t SaveRAMBlock::contentHash() {
+    uint64_t h = 0;
+    for (uint32_t page = 0; page << 8 < size; page++) {
+        if (unhashed & (1u << page))
+            pageHashes[page] = StateHash::bytes(data + (page << 8), std::min<uint32_t>(0x100, size - (page << 8)));
+        h = StateHash::mix(h, pageHashes[page]);
+    }
+    unhashed = 0;
+    return h;
+}
+
+bool SaveRAMBlock::isPersistent() const {
+    return fd >= 0;
+}
+
+void SaveRAMBlock::flush() {
+    if (fd < 0)
+        return;
+
+    uint64_t pages = dirty.exchange(0, std::memory_order_acquire);
+    while (pages) {
+        int page = __builtin_ctzll(pages);
+        pages &= pages - 1;
+
+        size_t start = size_t(page) << pageShift;
+        if (msync(data + start, size_t(1) << pageShift, MS_SYNC) != 0) {
+            // Keep the page dirty so the next flush retries it
+            dirty.fetch_or(uint64_t(1) << page, std::memory_order_relaxed);
+            GB_LOG(Log::LEVEL_WARN, Log::CAT_BUS, "msync failed for save page %d", page);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <array>
+
+#include "memory.h"
+
+// Battery-backed cartridge RAM (0xa000 - 0xbfff).
+// With a save path the block is an mmap'ed view of the .sav file: writes land in the page cache
+// directly and mark their host page dirty, and one background thread shared by every block msyncs
+// only the dirty pages.
+// Without a path it behaves like a plain RAMBlock.
+class SaveRAMBlock : public MemoryDevice {
+private:
+    uint8_t*  data = nullptr;
+    uint16_t  offset;
+    uint16_t  size;
+    const int memtype;
+
+    int       fd = -1;
+    size_t    mapped = 0;     // bytes mapped, rounded up to whole host pages
+    int       pageShift = 12; // log2 of the host page size
+    std::atomic<uint64_t> dirty{0}; // one bit per host page
+    uint32_t  written  = ~0u; // one bit per 256 bytes written since the last takeWrittenPages()
+    uint32_t  unhashed = ~0u; // the same since the last contentHash()
+    std::array<uint64_t, 32> pageHashes{};
+
+public:
+    SaveRAMBlock(uint16_t offset, uint16_t size, const std::string& path = "",
+                 std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    ~SaveRAMBlock() override;
+
+    SaveRAMBlock(const SaveRAMBlock&) = delete;
+    SaveRAMBlock& operator=(const SaveRAMBlock&) = delete;
+
+    uint8_t read(uint16_t addr) override;
+    bool    write(uint16_t addr, uint8_t val) override;
+    int     getMemtype() override;
+    int     relativeUpdate(uint16_t addr, uint8_t val) override;
+
+    bool    isPersistent() const;
+    void    copyStateFrom(const SaveRAMBlock& other);
+    void    flush(); // msync the pages dirtied since the last flush
+
+    // Incremental snapshots, the same as BasicBus::takeDirtyPages() with bus addresses
+    void    takeWrittenPages(const std::function<void(uint16_t, const uint8_t*)>& visit);
+    void    loadPage(uint16_t addr, const uint8_t* data);
+    uint64_t contentHash(); // rehashing only what was written since the last call
+};
@@ -0,0 +1,27 @@
+#include "watchpoints.h"
+
+void Watchpoints::add(uint16_t start, uint16_t end, int kinds) {
+    ranges.push_back({ start, end, kinds });
+    for (int page = start >> 8; page <= end >> 8; ++page) {
+        pageMask[page] |= kinds;
+    }
+}
+
+void Watchpoints::clear() {
+    ranges.clear();
+    pageMask.fill(0);
+    hit = false;
+}
+
+bool Watchpoints::slowCheck(uint16_t addr, int kind, uint8_t val) {
+    for (const Range& r : ranges) {
+        if ((r.kinds & kind) && addr >= r.start && addr <= r.end) {
+            hit = true;
+            last = { addr, kind, val };
+            if (onHit)
+                onHit(last);
+            return true;
+        }
+    }
+    return false;
+}
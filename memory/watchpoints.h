@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <functional>
+
+#include "memory.h"
+
+// watchpoint kinds, combinable
+enum WatchKind {
+    WATCH_READ  = 1,
+    WATCH_WRITE = 2,
+    WATCH_EXEC  = 4,
+};
+
+struct WatchHit {
+    uint16_t addr;
+    int      kind;
+    uint8_t  val;
+};
+
+// Bus debug policy for watchpoint/breakpoint runs.
+// A per-page mask of the kinds watched anywhere in that page keeps the common case to a single
+// test and branch; only accesses to a watched page look at the actual ranges.
+class Watchpoints {
+private:
+    struct Range {
+        uint16_t start;
+        uint16_t end;
+        int      kinds;
+    };
+
+    std::array<uint8_t, 0x100> pageMask{};
+    std::vector<Range>         ranges;
+
+    bool slowCheck(uint16_t addr, int kind, uint8_t val);
+
+public:
+    static constexpr bool enabled = true;
+
+    bool     hit = false; // latched until the owner clears it
+    WatchHit last{};
+    std::function<void(const WatchHit&)> onHit;
+
+    void add(uint16_t start, uint16_t end, int kinds);
+    void clear();
+
+    bool check(uint16_t addr, int kind, uint8_t val) {
+        if (!(pageMask[addr >> 8] & kind))
+            return false;
+        return slowCheck(addr, kind, val);
+    }
+};
+
+using DebugBus = BasicBus<Watchpoints>;
@@ -0,0 +1,106 @@
+#include "testing.h"
+
+#include <memory>
+
+#include "../Machine/Machine.h"
+#include "testrom.h"
+
+namespace Testing {
+
+namespace {
+
+constexpr uint16_t SOURCE = 0x0400; // ROM data the transfers start from, complemented into WRAM
+
+// Starts OAM DMA from WRAM, cartridge RAM and ROM in turn, each through a routine in HRAM that
+// reads ROM right after the write, 151 M-cycles after it and 166 M-cycles after it, and stores
+// the three reads from ffa0 on. After each of the first two transfers OAM is copied out to c200
+// and c300
+std::shared_ptr<const ROMImage> transferROM() {
+    TestROM rom;
+    auto copy = [&rom](uint16_t src, uint16_t dst, bool complement) {
+        rom.op({0x21, uint8_t(src), uint8_t(src >> 8)});  // ld hl,src
+        rom.op({0x11, uint8_t(dst), uint8_t(dst >> 8)});  // ld de,dst
+        rom.op({0x06, 0xa0});                             // ld b,a0
+        const std::string loop = std::format("copy{:04x}", dst);
+        rom.label(loop);
+        rom.op({0x2a});                                   // ld a,(hl+)
+        if (complement)
+            rom.op({0x2f});                               // cpl
+        rom.op({0x12, 0x13, 0x05});                       // ld (de),a ; inc de ; dec b
+        rom.jr(0x20, loop);
+    };
+    auto transfer = [&rom](uint8_t source, uint8_t slot) {
+        rom.op({0x06, source, 0x21, slot, 0xff});         // ld b,source ; ld hl,ff00+slot
+        rom.op({0xcd, 0x80, 0xff});                       // call ff80
+    };
+
+    // ld a,b ; ldh (46),a ; ld a,(SOURCE) ; ld (hl+),a
+    // ld a,23 ; wait: dec a ; jr nz,wait ; ld a,(SOURCE) ; ld (hl+),a
+    // ld a,02 ; wait: dec a ; jr nz,wait ; ld a,(SOURCE) ; ld (hl+),a ; ret
+    const uint8_t lo = uint8_t(SOURCE), hi = uint8_t(SOURCE >> 8);
+    const uint8_t routine[] = {0x78, 0xe0, 0x46, 0xfa, lo, hi, 0x22,
+                               0x3e, 0x23, 0x3d, 0x20, 0xfd, 0xfa, lo, hi, 0x22,
+                               0x3e, 0x02, 0x3d, 0x20, 0xfd, 0xfa, lo, hi, 0x22, 0xc9};
+    rom.op({0x21, 0x80, 0xff});                           // ld hl,ff80
+    for (uint8_t b : routine)
+        rom.op({0x36, b, 0x2c});                          // ld (hl),b ; inc l
+
+    copy(SOURCE, 0xc100, true);
+    transfer(0xc1, 0xa0);
+    copy(0xfe00, 0xc200, false);
+    transfer(0xa0, 0xa3);
+    copy(0xfe00, 0xc300, false);
+    transfer(uint8_t(SOURCE >> 8), 0xa6);
+    rom.label("end");
+    rom.jr(0x18, "end");
+    rom.data(SOURCE, OAMDMA::LENGTH, 0x3b);
+    return rom.image();
+}
+
+}
+
+// The CPU sees 0xff below HRAM while a transfer holds the bus, up to its last few M-cycles, and
+// memory again soon after its 160 M-cycles are over. OAM ends up holding the source, from WRAM,
+// cartridge RAM (no host pointer, so copied byte by byte) and ROM, on the plain bus and on the
+// watchpoint-capable one
+bool testOAMDMA() {
+    std::shared_ptr<const ROMImage> image = transferROM();
+    const char* sources[] = {"WRAM", "cartridge RAM", "ROM"};
+
+    for (bool debug : {false, true}) {
+        MachineOptions options;
+        options.debug = debug;
+        std::unique_ptr<Machine> machine = makeMachine(options);
+        machine->loadROM(image);
+        machine->reset(MODEL_DMG);
+        for (uint16_t i = 0; i < OAMDMA::LENGTH; i++)
+            machine->poke(0xa000 + i, uint8_t(i * 13 + 5));
+        machine->run(2 * Machine::FRAME_CYCLES);
+
+        const uint8_t romByte = machine->peek(SOURCE);
+        for (int t = 0; t < 3; t++) {
+            const uint8_t start = machine->peek(0xffa0 + 3 * t), end = machine->peek(0xffa1 + 3 * t);
+            const uint8_t after = machine->peek(0xffa2 + 3 * t);
+            if (start != 0xff || end != 0xff || after != romByte) {
+                printf("OAM DMA from %s (debug %d) let ROM read %02x, %02x and %02x, expected ff, ff and %02x\n",
+                       sources[t], debug, start, end, after, romByte);
+                return false;
+            }
+        }
+
+        for (uint16_t i = 0; i < OAMDMA::LENGTH; i++) {
+            const uint8_t expected[] = {uint8_t(~machine->peek(SOURCE + i)), uint8_t(i * 13 + 5), machine->peek(SOURCE + i)};
+            const uint8_t got[] = {machine->peek(0xc200 + i), machine->peek(0xc300 + i), machine->peek(0xfe00 + i)};
+            for (int t = 0; t < 3; t++) {
+                if (got[t] != expected[t]) {
+                    printf("OAM DMA from %s (debug %d) left %02x in OAM byte %d, expected %02x\n",
+                           sources[t], debug, got[t], i, expected[t]);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+};
@@ -0,0 +1,158 @@
+#include "testing.h"
+
+#include <cstring>
+#include <memory>
+#include <initializer_list>
+
+#include "../Machine/Machine.h"
+#include "testrom.h"
+
+// Differential tests for superinstructions (LR35902/fusion.cpp): the same ROM runs on a fusing
+// ProductionConfig machine and on a config that never fuses, both are stopped at the same
+// uneven slice boundaries, and everything observable has to match at every one of them.
+
+namespace Testing {
+
+namespace {
+
+bool sameStats(const Stats::Snapshot& a, const Stats::Snapshot& b) {
+    return a.instructions == b.instructions && a.mcycles == b.mcycles && a.haltedCycles == b.haltedCycles
+        && !memcmp(a.interrupts, b.interrupts, sizeof(a.interrupts))
+        && !memcmp(a.busReads, b.busReads, sizeof(a.busReads))
+        && !memcmp(a.busWrites, b.busWrites, sizeof(a.busWrites));
+}
+
+// Runs rom on both machines for the given number of slices and checks stats, registers and the
+// state hash after each, and all of memory every 64 slices. Each expected fusion kind and the
+// timer interrupt have to have been seen, or the test would not be testing them.
+bool compareFused(const std::string& name, std::shared_ptr<const ROMImage> rom, int slices,
+                  std::initializer_list<FusionKind> expected) {
+    MachineOptions plain;
+    plain.profile = true; // no profiler attached, the config alone turns fusion off
+    std::unique_ptr<Machine> fused = makeMachine(MachineOptions{});
+    std::unique_ptr<Machine> unfused = makeMachine(plain);
+    for (Machine* m : {fused.get(), unfused.get()}) {
+        m->loadROM(rom);
+        m->reset(MODEL_DMG);
+    }
+
+    uint64_t until = 0;
+    for (int i = 0; i < slices; i++) {
+        until += 1237 + (i * 977) % 5000;
+        fused->run(until);
+        unfused->run(until);
+
+        const CPU::Registers a = fused->registers(), b = unfused->registers();
+        bool match = sameStats(Stats::snapshot(fused->stats()), Stats::snapshot(unfused->stats()))
+                  && !memcmp(&a, &b, sizeof(a)) && fused->stateHash() == unfused->stateHash();
+        for (uint32_t addr = 0x8000; match && i % 64 == 63 && addr < 0x10000; addr++)
+            match = fused->peek(addr) == unfused->peek(addr);
+
+        if (!match) {
+            printf("Fused run of %s differs from the unfused one after slice %d (cycle %llu)\n",
+                   name.c_str(), i, (unsigned long long)until);
+            return false;
+        }
+    }
+
+    const Stats::Snapshot s = Stats::snapshot(fused->stats());
+    if (s.interrupts[INT_TIMER] == 0) {
+        printf("Fused run of %s never took a timer interrupt\n", name.c_str());
+        return false;
+    }
+    for (FusionKind kind : expected) {
+        if (s.fusions[kind] == 0) {
+            printf("Fused run of %s never used fusion kind %d\n", name.c_str(), int(kind));
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+// The four superinstructions, with a fast timer interrupting them
+bool testFusion() {
+    TestROM rom;
+    rom.timer(0x05);
+    rom.label("top");
+    rom.op({0x21, 0x00, 0x02});             // ld hl,0200
+    rom.op({0x11, 0x00, 0xc0});             // ld de,c000
+    rom.op({0x06, 0x40});                   // ld b,40
+    rom.label("copy");
+    rom.op({0x2a, 0x12, 0x13, 0x0d, 0x05}); // ld a,(hl+) ; ld (de),a ; inc de ; dec c ; dec b
+    rom.jr(0x20, "copy");
+    rom.op({0x01, 0x23, 0x01});             // ld bc,0123
+    rom.label("dec16");
+    rom.op({0x0b, 0x78, 0xb1});             // dec bc ; ld a,b ; or c
+    rom.jr(0x20, "dec16");
+    rom.label("div");
+    rom.op({0xf0, 0x04, 0xfe, 0x80});       // ldh a,(04) ; cp 80
+    rom.jr(0x38, "div");
+    rom.label("tima");
+    rom.op({0xf0, 0x05, 0xfe, 0x40});       // ldh a,(05) ; cp 40
+    rom.jr(0x30, "tima");
+    rom.op({0x0e, 0x33});                   // ld c,33
+    rom.label("dec");
+    rom.op({0x0d});                         // dec c
+    rom.jr(0x20, "dec");
+    rom.op({0x21, 0x00, 0xd0, 0x34});       // ld hl,d000 ; inc (hl)
+    rom.jp("top");
+    rom.data(0x0200, 0x40, 0);
+
+    return compareFused("superinstructions", rom.image(), 3000,
+                        {FUSE_COPY_BYTE, FUSE_DEC_JRNZ, FUSE_DEC16_JRNZ, FUSE_LDH_CP_JR});
+}
+
+// Copy and fill loops run as bulk transfers, over every kind of source and destination the bus
+// either accepts or has to refuse, with the timer interrupting them at two rates
+bool testFusedLoops() {
+    auto copy8 = [](TestROM& rom, uint16_t src, uint16_t dst, uint8_t count, bool c) {
+        rom.op({0x21, uint8_t(src), uint8_t(src >> 8)});   // ld hl,src
+        rom.op({0x11, uint8_t(dst), uint8_t(dst >> 8)});   // ld de,dst
+        rom.op({uint8_t(c ? 0x0e : 0x06), count});          // ld b/c,count
+        rom.op({0x2a, 0x12, 0x13, uint8_t(c ? 0x0d : 0x05), 0x20, 0xfa});
+    };
+    auto copy16 = [](TestROM& rom, uint16_t src, uint16_t dst, uint16_t count) {
+        rom.op({0x21, uint8_t(src), uint8_t(src >> 8)});
+        rom.op({0x11, uint8_t(dst), uint8_t(dst >> 8)});
+        rom.op({0x01, uint8_t(count), uint8_t(count >> 8)}); // ld bc,count
+        rom.op({0x2a, 0x12, 0x13, 0x0b, 0x78, 0xb1, 0x20, 0xf8});
+    };
+    auto fill = [](TestROM& rom, uint16_t dst, uint8_t val, uint8_t count, int reg) {
+        rom.op({0x21, uint8_t(dst), uint8_t(dst >> 8)});
+        rom.op({0x3e, val});                                // ld a,val
+        rom.op({uint8_t(0x06 + reg * 8), count});           // ld b/c/d/e,count
+        rom.op({0x22, uint8_t(0x05 + reg * 8), 0x20, 0xfc});
+    };
+
+    bool ok = true;
+    for (uint8_t tac : {0x05, 0x04}) {
+        TestROM rom;
+        rom.timer(tac);
+        rom.label("top");
+        copy8(rom, 0x0400, 0x8000, 0x40, false);
+        copy8(rom, 0x0400, 0x9f80, 0x00, true);   // 256 bytes from VRAM on into cartridge RAM
+        copy16(rom, 0x1000, 0xc000, 0x1800);
+        copy8(rom, 0xc010, 0xc011, 0x80, false);  // overlapping, every byte reads the one just stored
+        copy8(rom, 0xe020, 0xc100, 0x40, true);   // from echo RAM
+        copy8(rom, 0xfef0, 0xc200, 0x20, false);  // runs into the IO registers
+        fill(rom, 0xc300, 0x5a, 0x00, 0);         // 256 bytes
+        fill(rom, 0xc400, 0xa5, 0x33, 2);
+        fill(rom, 0xdff0, 0x11, 0x30, 3);         // on into echo RAM
+        fill(rom, 0xff70, 0x77, 0x20, 0);         // on into HRAM
+        rom.op({0x21, 0x00, 0xd0, 0x34});         // ld hl,d000 ; inc (hl)
+        rom.op({0xf0, 0x04, 0xea, 0x01, 0xd0});   // ldh a,(04) ; ld (d001),a
+        // 65536 bytes, wrapping around the address space through IO and the stack. Last, as
+        // whatever the program does after it, both machines have to do the same
+        copy16(rom, 0x1000, 0xd000, 0x0000);
+        rom.jp("top");
+        rom.data(0x0400, 0x7c00, tac);
+
+        ok &= compareFused(std::format("copy and fill loops, TAC {:02x}", tac), rom.image(), 3000,
+                           {FUSE_COPY_LOOP, FUSE_FILL_LOOP});
+    }
+    return ok;
+}
+
+};
@@ -0,0 +1,95 @@
+#include "testing.h"
+
+#include <filesystem>
+
+#include "../Joypad/Joypad.h"
+#include "../Machine/Machine.h"
+#include "../Movie/Movie.h"
+#include "testrom.h"
+
+namespace Testing {
+
+// P1 reads for each select combination, and an interrupt exactly when a selected line falls
+bool testJoypad() {
+    int interrupts = 0;
+    Joypad pad([&interrupts] { interrupts++; });
+
+    struct Step {
+        int     select;   // value written to P1, -1 for none
+        int     buttons;  // new button mask, -1 for unchanged
+        uint8_t p1;       // expected read
+        int     interrupts;
+    };
+    const Step steps[] = {
+        {-1,   -1,                         0xff, 0}, // nothing selected
+        {-1,   BUTTON_A,                   0xff, 0}, // held but not selected
+        {0x10, -1,                         0xde, 1}, // selecting the action group with A held
+        {0x10, BUTTON_A | BUTTON_START,    0xd6, 2}, // Start falls
+        {0x10, BUTTON_START,               0xd7, 2}, // A rises
+        {0x20, -1,                         0xef, 2}, // d-pad, nothing held there
+        {0x20, BUTTON_START | BUTTON_RIGHT, 0xee, 3}, // Right falls
+        {0x00, -1,                         0xc6, 4}, // both groups, Start's line falls too
+        {0x30, -1,                         0xff, 4}, // deselecting never interrupts
+    };
+
+    for (const Step& step : steps) {
+        if (step.select >= 0)
+            pad.write(0xff00, step.select);
+        if (step.buttons >= 0)
+            pad.setButtons(step.buttons);
+        if (pad.read(0xff00) != step.p1 || interrupts != step.interrupts) {
+            printf("Joypad P1 %02x with %d interrupts, expected %02x with %d\n",
+                   pad.read(0xff00), interrupts, step.p1, step.interrupts);
+            return false;
+        }
+    }
+
+    pad.reset();
+    return pad.read(0xff00) == 0xff && pad.buttons() == 0;
+}
+
+// A movie survives a save/load round trip, and replaying it twice on the same machine ends in
+// the same state both times although the game keeps a running total in cartridge RAM
+bool testMovie() {
+    TestROM rom;
+    rom.op({0x3e, 0x20, 0xe0, 0x00});       // ld a,20 ; ldh (00),a    select the d-pad
+    rom.label("top");
+    rom.op({0xf0, 0x00, 0x21, 0x00, 0xa0}); // ldh a,(00) ; ld hl,a000
+    rom.op({0x86, 0x77});                   // add (hl) ; ld (hl),a
+    rom.jr(0x18, "top");
+
+    std::unique_ptr<Machine> machine = makeMachine(MachineOptions{});
+    machine->loadROM(rom.image());
+    machine->poke(0xa000, 0x5a);
+
+    Movie movie(*machine, MODEL_DMG);
+    movie.begin(*machine);
+    for (int i = 0; i < 60; i++) {
+        const uint8_t buttons = uint8_t(i * 37) & 0x0f;
+        movie.record(buttons);
+        runFrame(*machine, buttons);
+    }
+    const uint64_t recorded = machine->stateHash();
+
+    const std::string path = (std::filesystem::temp_directory_path() / "gb-test.gbmv").string();
+    movie.save(path);
+    const Movie loaded = Movie::load(path);
+    std::filesystem::remove(path);
+    if (loaded.model != movie.model || loaded.romChecksum != movie.romChecksum
+        || loaded.frames != movie.frames || loaded.saveRAM != movie.saveRAM) {
+        printf("Movie differs after a save/load round trip\n");
+        return false;
+    }
+
+    for (int replay = 0; replay < 2; replay++) {
+        loaded.begin(*machine);
+        loaded.play(*machine);
+        if (machine->stateHash() != recorded) {
+            printf("Movie replay %d ended in a different state\n", replay);
+            return false;
+        }
+    }
+    return true;
+}
+
+};
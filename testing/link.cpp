@@ -0,0 +1,138 @@
+#include "testing.h"
+
+#include <memory>
+#include <vector>
+
+#include "../Machine/Machine.h"
+#include "../LinkCable/LinkCable.h"
+#include "testrom.h"
+
+namespace Testing {
+
+namespace {
+
+constexpr int BYTES = 32;
+
+// Sends 0, 1, ... on the internal clock, each after a delay of 8 * n iterations (n = 0 standing
+// for 256), so transfers start at every distance from a link meeting, and stores what comes back
+// from c000 on
+std::shared_ptr<const ROMImage> clockingROM() {
+    TestROM rom;
+    rom.op({0x21, 0x00, 0xc0, 0x0e, 0x00});       // ld hl,c000 ; ld c,00
+    rom.label("loop");
+    rom.op({0x79, 0x07, 0x07, 0x07, 0x47});       // ld a,c ; rlca ; rlca ; rlca ; ld b,a
+    rom.label("delay");
+    rom.op({0x05});                               // dec b
+    rom.jr(0x20, "delay");
+    rom.op({0x79, 0xe0, 0x01, 0x3e, 0x81, 0xe0, 0x02}); // ld a,c ; ldh (01),a ; ld a,81 ; ldh (02),a
+    rom.label("wait");
+    rom.op({0xf0, 0x02, 0xcb, 0x7f});             // ldh a,(02) ; bit 7,a
+    rom.jr(0x20, "wait");
+    rom.op({0xf0, 0x01, 0x22, 0x0c, 0x7d, 0xfe, BYTES}); // ldh a,(01) ; ld (hl+),a ; inc c ; ld a,l ; cp BYTES
+    rom.jr(0x20, "loop");
+    rom.label("end");
+    rom.jr(0x18, "end");
+    return rom.image();
+}
+
+// Waits on the external clock with ~0, ~1, ... in SB and stores what comes in from c000 on
+std::shared_ptr<const ROMImage> listeningROM() {
+    TestROM rom;
+    rom.op({0x21, 0x00, 0xc0, 0x0e, 0x00});       // ld hl,c000 ; ld c,00
+    rom.label("loop");
+    rom.op({0x79, 0x2f, 0xe0, 0x01, 0x3e, 0x80, 0xe0, 0x02}); // ld a,c ; cpl ; ldh (01),a ; ld a,80 ; ldh (02),a
+    rom.label("wait");
+    rom.op({0xf0, 0x02, 0xcb, 0x7f});             // ldh a,(02) ; bit 7,a
+    rom.jr(0x20, "wait");
+    rom.op({0xf0, 0x01, 0x22, 0x0c, 0x7d, 0xfe, BYTES}); // ldh a,(01) ; ld (hl+),a ; inc c ; ld a,l ; cp BYTES
+    rom.jr(0x20, "loop");
+    rom.label("end");
+    rom.jr(0x18, "end");
+    return rom.image();
+}
+
+struct Ends {
+    std::unique_ptr<Machine> clocking = makeMachine(MachineOptions{});
+    std::unique_ptr<Machine> listening = makeMachine(MachineOptions{});
+    std::vector<uint64_t> ended[2];   // cycle each transfer completed at, per side
+    std::vector<uint64_t> planned;    // where the clocking side's transfers were due
+
+    Ends() {
+        clocking->loadROM(clockingROM());
+        listening->loadROM(listeningROM());
+        clocking->reset(MODEL_DMG);
+        listening->reset(MODEL_DMG);
+        clocking->serial().onSerial = [this](uint8_t) {
+            ended[0].push_back(clocking->scheduler().now);
+            planned.push_back(clocking->serial().completion());
+        };
+        listening->serial().onSerial = [this](uint8_t) { ended[1].push_back(listening->scheduler().now); };
+    }
+};
+
+// Both sides received each other's bytes, on the same cycle, no earlier than the clocking side
+// had the transfer due and less than lateness after it
+bool checkExchange(Ends& ends, uint64_t quantum, uint64_t lateness) {
+    if (ends.ended[0].size() != BYTES || ends.ended[1] != ends.ended[0]) {
+        printf("Link at quantum %llu completed %zu and %zu transfers, expected %d on the same cycles\n",
+               (unsigned long long)quantum, ends.ended[0].size(), ends.ended[1].size(), BYTES);
+        return false;
+    }
+    for (int i = 0; i < BYTES; i++) {
+        const uint8_t got[2] = {ends.clocking->peek(0xc000 + i), ends.listening->peek(0xc000 + i)};
+        if (got[0] != uint8_t(~i) || got[1] != i) {
+            printf("Link at quantum %llu exchanged %02x/%02x for byte %d, expected %02x/%02x\n",
+                   (unsigned long long)quantum, got[0], got[1], i, uint8_t(~i), i);
+            return false;
+        }
+        if (ends.ended[0][i] < ends.planned[i] || ends.ended[0][i] - ends.planned[i] >= lateness) {
+            printf("Link at quantum %llu ended transfer %d at cycle %llu, it was due at %llu\n",
+                   (unsigned long long)quantum, i, (unsigned long long)ends.ended[0][i],
+                   (unsigned long long)ends.planned[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+// An internal-clock side and an external-clock side swap SB over a LinkCable. At the default
+// quantum every transfer ends on the cycle it ends on unlinked; at a frame-long one it may end
+// late, but within the quantum
+bool testLinkCable() {
+    const uint64_t until = (BYTES + 2) * Machine::FRAME_CYCLES; // room for every transfer to be a quantum late
+
+    // Unlinked, the clocking side runs the same program (it never branches on what it receives),
+    // so its transfers end on the cycles a cycle-exact link has to match
+    Ends alone;
+    alone.clocking->run(until);
+
+    Ends exact;
+    {
+        LinkCable cable(*exact.clocking, *exact.listening);
+        cable.run(until);
+    }
+    if (!checkExchange(exact, Serial::MIN_TRANSFER_CYCLES, 1))
+        return false;
+    if (exact.ended[0] != alone.ended[0]) {
+        printf("Link at the default quantum moved transfers off their unlinked cycles\n");
+        return false;
+    }
+
+    Ends coarse;
+    {
+        LinkCable cable(*coarse.clocking, *coarse.listening, Machine::FRAME_CYCLES);
+        cable.run(until);
+    }
+    if (!checkExchange(coarse, Machine::FRAME_CYCLES, Machine::FRAME_CYCLES))
+        return false;
+    if (coarse.ended[0] == coarse.planned) {
+        printf("Link at quantum %llu ended every transfer on time, so it tested nothing\n",
+               (unsigned long long)Machine::FRAME_CYCLES);
+        return false;
+    }
+    return true;
+}
+
+};
@@ -1,5 +1,12 @@
 #include "testing.h"
 
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+
+#include "../TraceIndex/TraceIndex.h"
+
 namespace Testing {
 
 bool compareCpuState(CPU::LR35902& cpu, json& state) {
@@ -34,7 +41,7 @@ void setMachineStateJSON(Bus& bus, CPU::LR35902& cpu, json& state) {
 
     for (auto& ramEdit : state["ram"]) {
         // std::cout << ramEdit << std::endl;
-        bus.write(ramEdit[0], ramEdit[1]);
+        bus.poke(ramEdit[0], ramEdit[1]);
     }
 }
 
@@ -55,6 +62,135 @@ void testOpcode(Bus& bus, CPU::LR35902& cpu, std::string opcode, int numToTest)
     }
 }
 
+static CPU::Registers registersFromJSON(json& state) {
+    return CPU::Registers{
+        state["a"].get<uint8_t>(), state["f"].get<uint8_t>(),
+        state["b"].get<uint8_t>(), state["c"].get<uint8_t>(),
+        state["d"].get<uint8_t>(), state["e"].get<uint8_t>(),
+        state["h"].get<uint8_t>(), state["l"].get<uint8_t>(),
+        state["sp"].get<uint16_t>(), state["pc"].get<uint16_t>(),
+    };
+}
+
+// Run the fixtures for one opcode through the scalar core and through LaneEngine, one test
+// case per lane, and check both end in the same registers and memory
+bool testLaneEngine(Bus& bus, CPU::LR35902& cpu, std::string opcode, int numToTest) {
+    std::fstream f(std::format("V1/{}.json", opcode));
+    json data = json::parse(f);
+    const int count = std::min<int>(numToTest, data.size());
+
+    LaneEngine lanes;
+    for (int base = 0; base < count; base += LaneEngine::LANES) {
+        const int n = std::min(LaneEngine::LANES, count - base);
+
+        for (int lane = 0; lane < n; lane++) {
+            json& initial = data[base + lane]["initial"];
+            CPU::Registers regs = registersFromJSON(initial);
+            lanes.core(lane).reset(regs);
+            lanes.setLane(lane, regs);
+            for (auto& ramEdit : initial["ram"])
+                lanes.bus(lane).write(ramEdit[0], ramEdit[1]);
+        }
+        lanes.step();
+
+        for (int lane = 0; lane < n; lane++) {
+            json& test = data[base + lane];
+            cpu.reset(registersFromJSON(test["initial"]));
+            setMachineStateJSON(bus, cpu, test["initial"]);
+            cpu.wait = 0;
+            cpu.insCycle();
+
+            CPU::Registers want = cpu.getRegisters();
+            CPU::Registers got  = lanes.getLane(lane);
+            bool match = memcmp(&want, &got, sizeof(want)) == 0;
+            for (const json& list : {test["initial"]["ram"], test["final"]["ram"]}) {
+                for (const auto& ramEntry : list) {
+                    uint16_t addr = ramEntry[0].get<uint16_t>();
+                    match &= bus.read(addr) == lanes.bus(lane).read(addr);
+                }
+            }
+
+            if (!match) {
+                printf("Lane engine differs from the scalar core at index %d for opcode %s\n", base + lane, opcode.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Batches where every lane runs its own opcode, mostly from a handful of vectorizable ones so
+// lanes share them, against one scalar core per lane. Exercises the per-opcode masks of step()
+// and the scalar fallback side by side; memory persists across batches on both sides.
+bool testLaneEngineMixed(int batches) {
+    struct Reference {
+        Bus                 bus;
+        InterruptController irq;
+        CPU::LR35902        core{bus, irq};
+    };
+
+    static const uint8_t common[] = { 0x04, 0x0d, 0x3c, 0x41, 0x78, 0x80, 0x89, 0x92, 0x9b, 0xa0, 0xaf, 0xb1, 0xbf };
+    static const uint8_t skipped[] = { 0x10, 0x76, 0xd3, 0xdb, 0xdd, 0xe3, 0xe4, 0xeb, 0xec, 0xed, 0xf4, 0xfc, 0xfd };
+
+    std::mt19937 rng(0x6b0);
+    auto byte = [&rng] { return uint8_t(rng()); };
+
+    LaneEngine lanes;
+    std::vector<std::unique_ptr<Reference>> refs;
+    for (int lane = 0; lane < LaneEngine::LANES; lane++) {
+        refs.push_back(std::make_unique<Reference>());
+        refs.back()->bus.mapMemory(0x0000, 0xffff, MEM_TYPE_RAM);
+    }
+
+    for (int batch = 0; batch < batches; batch++) {
+        std::array<std::vector<uint16_t>, LaneEngine::LANES> touched;
+
+        for (int lane = 0; lane < LaneEngine::LANES; lane++) {
+            CPU::Registers regs{byte(), uint8_t(byte() & 0xf0), byte(), byte(), byte(), byte(), byte(), byte(),
+                                uint16_t(rng()), uint16_t(0x0100 + rng() % 0xbe00)};
+            uint8_t op;
+            do {
+                op = rng() % 4 ? common[rng() % std::size(common)] : byte();
+            } while (std::find(std::begin(skipped), std::end(skipped), op) != std::end(skipped));
+            const uint8_t code[3] = {op, byte(), byte()};
+
+            lanes.core(lane).reset(regs);
+            lanes.setLane(lane, regs);
+            refs[lane]->core.reset(regs);
+            for (int i = 0; i < 3; i++) {
+                lanes.bus(lane).poke(regs.pc + i, code[i]);
+                refs[lane]->bus.poke(regs.pc + i, code[i]);
+            }
+
+            // Every address a one-byte-opcode instruction can store to
+            const uint16_t bc = regs.b << 8 | regs.c, de = regs.d << 8 | regs.e, hl = regs.h << 8 | regs.l;
+            const uint16_t a16 = code[2] << 8 | code[1];
+            touched[lane] = { bc, de, hl, uint16_t(hl - 1), uint16_t(hl + 1), uint16_t(regs.sp - 1), uint16_t(regs.sp - 2),
+                              a16, uint16_t(a16 + 1), uint16_t(0xff00 | code[1]), uint16_t(0xff00 | regs.c) };
+        }
+
+        lanes.step();
+
+        for (int lane = 0; lane < LaneEngine::LANES; lane++) {
+            Reference& ref = *refs[lane];
+            ref.core.wait = 0;
+            ref.core.insCycle();
+
+            CPU::Registers want = ref.core.getRegisters();
+            CPU::Registers got  = lanes.getLane(lane);
+            bool match = memcmp(&want, &got, sizeof(want)) == 0;
+            for (uint16_t addr : touched[lane])
+                match &= ref.bus.peek(addr) == lanes.bus(lane).peek(addr);
+
+            if (!match) {
+                printf("Lane engine differs from the scalar core in batch %d, lane %d\n", batch, lane);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void test1byteOpcodes(Bus& bus, CPU::LR35902& cpu) {
     for(int i = 0x00; i <= 0xff; i++) {
         cpu.wait = 0;
@@ -74,6 +210,8 @@ void test1byteOpcodes(Bus& bus, CPU::LR35902& cpu) {
         )
             continue;
         testOpcode(bus, cpu, std::format("{:02x}", i), 999);
+        if (LaneEngine::vectorizable(i))
+            testLaneEngine(bus, cpu, std::format("{:02x}", i), 999);
     }
 }
 
@@ -83,4 +221,47 @@ void testCBopcodes(Bus& bus, CPU::LR35902& cpu){
     }
 }
 
+static void writeTrace(const std::string& path, int lines) {
+    std::ofstream out(path, std::ios::trunc);
+    for (int i = 0; i < lines; i++)
+        out << std::format("A:{:02X} F:00 B:00 C:00 D:00 E:00 H:00 L:00 SP:FFFE PC:{:04X} PCMEM:00,00,00,00\n", i & 0xff, 0x100 + i);
+}
+
+// An index left behind by a longer trace must not be trusted for the new one
+bool testStaleTraceIndex() {
+    const std::string path = (std::filesystem::temp_directory_path() / "gb-stale-trace.txt").string();
+    writeTrace(path, 5000);
+    TraceIndexer::build(path).write(path);
+    writeTrace(path, 100);
+
+    bool match;
+    {
+        TraceFile file(path);
+        match = file.lineCount() == 100 && file.range(4500, 1).empty()
+             && file.line(50) == std::format("A:32 F:00 B:00 C:00 D:00 E:00 H:00 L:00 SP:FFFE PC:{:04X} PCMEM:00,00,00,00", 0x100 + 50)
+             && file.firstVisits(0x100 + 4500).empty();
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(traceIndexPath(path));
+
+    if (!match)
+        printf("Stale trace index was used\n");
+    return match;
+}
+
+bool runSelfTests() {
+    bool ok = true;
+    ok &= testStaleTraceIndex();
+    ok &= testLaneEngineMixed();
+    ok &= testFusion();
+    ok &= testFusedLoops();
+    ok &= testJoypad();
+    ok &= testMovie();
+    ok &= testLinkCable();
+    ok &= testDeltaSnapshots();
+    ok &= testOAMDMA();
+    printf("Self tests %s\n", ok ? "passed" : "FAILED");
+    return ok;
+}
+
 };
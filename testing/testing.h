@@ -6,6 +6,7 @@
 #include "../Reg8/Reg8.h"
 #include "../Reg16/Reg16.h"
 #include "../LR35902/LR35902.h"
+#include "../LaneEngine/LaneEngine.h"
 
 namespace Testing {
 
@@ -14,5 +15,18 @@ void setMachineStateJSON(Bus& bus, CPU::LR35902& cpu, json& state);
 void testOpcode(Bus& bus, CPU::LR35902& cpu, std::string opcode, int numToTest = 1);
 void test1byteOpcodes(Bus& bus, CPU::LR35902& cpu);
 void testCBopcodes(Bus& bus, CPU::LR35902& cpu);
+bool testLaneEngine(Bus& bus, CPU::LR35902& cpu, std::string opcode, int numToTest = 1000);
+
+// Tests that need no fixture files
+bool testStaleTraceIndex();
+bool testLaneEngineMixed(int batches = 2000); // 2000 batches of LANES lane-steps each
+bool testFusion(); // fused against unfused machines, see fusion.cpp
+bool testFusedLoops();
+bool testJoypad();
+bool testMovie();
+bool testLinkCable(); // link.cpp
+bool testDeltaSnapshots(); // snapshot.cpp
+bool testOAMDMA(); // dma.cpp
+bool runSelfTests();
 
 };
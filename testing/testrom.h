@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <initializer_list>
+#include <algorithm>
+
+#include "../memory/romimage.h"
+
+namespace Testing {
+
+// Just enough of an assembler for test ROMs: code from 0x150 (entered from 0x100) and a timer
+// interrupt handler that logs B into HRAM, so interrupts land in the middle of fused sequences
+class TestROM {
+private:
+    std::vector<uint8_t>                         rom = std::vector<uint8_t>(0x8000);
+    uint16_t                                     pc = 0x150;
+    std::map<std::string, uint16_t>              labels;
+    std::vector<std::pair<uint16_t, std::string>> relative; // JR offsets to patch
+    std::vector<std::pair<uint16_t, std::string>> absolute; // JP targets to patch
+
+public:
+    TestROM() {
+        const uint8_t entry[] = {0x00, 0xc3, 0x50, 0x01};
+        std::copy(std::begin(entry), std::end(entry), rom.begin() + 0x100);
+
+        // push af ; push hl ; ld hl,ff90 ; ldh a,(80) ; and 0f ; add l ; ld l,a ; ld (hl),b
+        // ldh a,(80) ; inc a ; ldh (80),a ; pop hl ; pop af ; reti
+        const uint8_t isr[] = {0xf5, 0xe5, 0x21, 0x90, 0xff, 0xf0, 0x80, 0xe6, 0x0f, 0x85, 0x6f, 0x70,
+                               0xf0, 0x80, 0x3c, 0xe0, 0x80, 0xe1, 0xf1, 0xd9};
+        std::copy(std::begin(isr), std::end(isr), rom.begin() + 0x50);
+    }
+
+    void op(std::initializer_list<uint8_t> bytes) {
+        for (uint8_t b : bytes)
+            rom.at(pc++) = b;
+    }
+
+    void label(const std::string& name) {
+        labels[name] = pc;
+    }
+
+    void jr(uint8_t opcode, const std::string& target) {
+        op({opcode, 0x00});
+        relative.emplace_back(pc - 1, target);
+    }
+
+    void jp(const std::string& target) {
+        op({0xc3, 0x00, 0x00});
+        absolute.emplace_back(pc - 2, target);
+    }
+
+    // Enable the timer interrupt at the given TAC
+    void timer(uint8_t tac) {
+        op({0x31, 0xfe, 0xff});        // ld sp,fffe
+        op({0x3e, tac, 0xe0, 0x07});   // ld a,tac ; ldh (07),a
+        op({0x3e, 0x04, 0xe0, 0xff});  // ld a,04 ; ldh (ff),a
+        op({0xfb});                    // ei
+    }
+
+    void data(uint16_t addr, uint16_t length, uint8_t seed) {
+        for (uint32_t i = 0; i < length; i++)
+            rom.at(addr + i) = uint8_t(i * 7 + seed * (i >> 8) + seed);
+    }
+
+    std::shared_ptr<const ROMImage> image() {
+        for (const auto& [at, target] : relative)
+            rom[at] = uint8_t(labels.at(target) - (at + 1));
+        for (const auto& [at, target] : absolute) {
+            rom[at]     = labels.at(target) & 0xff;
+            rom[at + 1] = labels.at(target) >> 8;
+        }
+        return std::make_shared<const ROMImage>(rom);
+    }
+};
+
+}
@@ -0,0 +1,40 @@
+// Run-ahead benchmark: replays a movie with 0 .. max frames of run-ahead and reports the
+// per-frame cost of each setting.
+//
+//   runahead <rom> <movie> [max frames ahead]
+#include <stdio.h>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+
+#include "../Machine/Machine.h"
+#include "../Movie/Movie.h"
+#include "../RunAhead/RunAhead.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: runahead <rom> <movie> [max frames ahead]\n");
+        return 2;
+    }
+
+    try {
+        const std::shared_ptr<const ROMImage> rom = ROMImage::load(argv[1]);
+        const Movie movie = Movie::load(argv[2]);
+        const int   most  = argc > 3 ? std::stoi(argv[3]) : 3;
+
+        for (int frames = 0; frames <= most; frames++) {
+            std::unique_ptr<Machine> machine = makeMachine({});
+            machine->loadROM(rom);
+            movie.begin(*machine);
+
+            RunAhead ahead(*machine, frames);
+            for (uint8_t buttons : movie.frames)
+                ahead.frame(buttons);
+            ahead.report(std::cout);
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "runahead: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Trace index tool for gameboy-doctor logs.
+//
+//   traceidx build <trace> [stride]       write <trace>.idx
+//   traceidx line  <trace> <n> [count]    print lines n .. n+count-1 (0-based)
+//   traceidx pc    <trace> <hex> [count]  print the first visits of an address
+//   traceidx info  <trace>
+#include <stdio.h>
+#include <string>
+#include <stdexcept>
+
+#include "../TraceIndex/TraceIndex.h"
+
+static int usage() {
+    fprintf(stderr,
+        "usage: traceidx build <trace> [stride]\n"
+        "       traceidx line  <trace> <n> [count]\n"
+        "       traceidx pc    <trace> <hex pc> [count]\n"
+        "       traceidx info  <trace>\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3)
+        return usage();
+
+    const std::string cmd   = argv[1];
+    const std::string trace = argv[2];
+
+    try {
+        if (cmd == "build") {
+            uint32_t stride = argc > 3 ? std::stoul(argv[3]) : 1024;
+            TraceIndexer index = TraceIndexer::build(trace, stride);
+            index.write(trace);
+            return 0;
+        }
+
+        TraceFile file(trace);
+
+        if (cmd == "info") {
+            printf("%llu lines\n", (unsigned long long)file.lineCount());
+        } else if (cmd == "line" && argc > 3) {
+            uint64_t n     = std::stoull(argv[3]);
+            uint64_t count = argc > 4 ? std::stoull(argv[4]) : 1;
+            std::string_view lines = file.range(n, count);
+            fwrite(lines.data(), 1, lines.size(), stdout);
+        } else if (cmd == "pc" && argc > 3) {
+            uint16_t pc    = std::stoul(argv[3], nullptr, 16);
+            size_t   count = argc > 4 ? std::stoul(argv[4]) : 1;
+            std::vector<uint64_t> visits = file.firstVisits(pc);
+            if (visits.empty())
+                printf("PC %04X never executed\n", pc);
+            for (size_t i = 0; i < visits.size() && i < count; i++) {
+                std::string_view line = file.line(visits[i]);
+                printf("%llu: %.*s\n", (unsigned long long)visits[i], int(line.size()), line.data());
+            }
+        } else {
+            return usage();
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}